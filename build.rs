@@ -3,6 +3,16 @@ extern crate cc;
 
 fn main() {
     let env = env::var("TARGET").unwrap();
+    let target_os = env::var("CARGO_CFG_TARGET_OS").unwrap_or(String::new());
+
+    // minifb_x11 is set when the X11 backend is used, the same selection as in src/os/mod.rs
+    println!("cargo:rustc-check-cfg=cfg(minifb_x11)");
+
+    if ["linux", "freebsd", "dragonfly", "netbsd", "openbsd"].contains(&target_os.as_str()) &&
+       env::var("CARGO_FEATURE_RFB").is_err() {
+        println!("cargo:rustc-cfg=minifb_x11");
+    }
+
     if env.contains("darwin") {
         cc::Build::new()
             .flag("-mmacosx-version-min=10.10")
@@ -13,8 +23,16 @@ fn main() {
         println!("cargo:rustc-link-lib=framework=Metal");
         println!("cargo:rustc-link-lib=framework=MetalKit");
     } else if env.contains("linux") {
-        cc::Build::new()
-            .file("src/native/x11/X11MiniFB.c")
-            .compile("libminifb_native.a");
+        // The RFB backend doesn't use X11 so it can be built without the X11 headers
+        if env::var("CARGO_FEATURE_RFB").is_ok() {
+            cc::Build::new()
+                .file("src/native/x11/FrameRing.c")
+                .compile("libminifb_native.a");
+        } else {
+            cc::Build::new()
+                .file("src/native/x11/X11MiniFB.c")
+                .file("src/native/x11/FrameRing.c")
+                .compile("libminifb_native.a");
+        }
     }
 }
@@ -0,0 +1,189 @@
+extern crate minifb;
+
+use minifb::draw::{Canvas, FONT_HEIGHT};
+use minifb::{Key, Window, WindowOptions};
+use std::time::Instant;
+
+const WIDTH: usize = 640;
+const HEIGHT: usize = 360;
+
+// Measures the throughput of the drawing primitives against the per-pixel loops they replace and
+// then shows them in a window together with the results. Build with --release to get meaningful
+// numbers:
+//
+//   cargo run --release --example draw
+
+const SPRITE: usize = 64;
+const ROUNDS: usize = 200;
+
+fn seconds(start: Instant) -> f64 {
+    let elapsed = start.elapsed();
+    elapsed.as_secs() as f64 + elapsed.subsec_nanos() as f64 / 1_000_000_000.0
+}
+
+// Runs f ROUNDS times and returns the GB/s of written pixels
+fn measure<F: FnMut(usize)>(bytes: usize, mut f: F) -> f64 {
+    let start = Instant::now();
+
+    for round in 0..ROUNDS {
+        f(round);
+    }
+
+    (bytes * ROUNDS) as f64 / seconds(start) / 1e9
+}
+
+// The naive versions take the size of the sprite as arguments like a blit function for images
+// loaded at runtime would
+#[inline(never)]
+fn naive_blit(buffer: &mut [u32], x: usize, y: usize, sprite: &[u32], width: usize, height: usize) {
+    for sy in 0..height {
+        for sx in 0..width {
+            buffer[(y + sy) * WIDTH + x + sx] = sprite[sy * width + sx];
+        }
+    }
+}
+
+#[inline(never)]
+fn naive_blit_alpha(buffer: &mut [u32], x: usize, y: usize, sprite: &[u32], width: usize, height: usize) {
+    for sy in 0..height {
+        for sx in 0..width {
+            let pixel = &mut buffer[(y + sy) * WIDTH + x + sx];
+            *pixel = naive_blend(*pixel, sprite[sy * width + sx]);
+        }
+    }
+}
+
+fn naive_blend(dest: u32, src: u32) -> u32 {
+    let alpha = src >> 24;
+    let mut out = 0;
+
+    for shift in [0, 8, 16].iter() {
+        let s = (src >> shift) & 0xff;
+        let d = (dest >> shift) & 0xff;
+        out |= ((s * alpha + d * (255 - alpha)) / 255) << shift;
+    }
+
+    out
+}
+
+fn benchmark(buffer: &mut [u32], sprite: &[u32]) -> Vec<String> {
+    let frame_bytes = WIDTH * HEIGHT * 4;
+    let sprites_x = WIDTH / SPRITE;
+    let sprites_y = HEIGHT / SPRITE;
+    let sprite_bytes = sprites_x * sprites_y * SPRITE * SPRITE * 4;
+    let mut results = Vec::new();
+
+    let naive = measure(frame_bytes, |round| {
+        for y in 0..HEIGHT {
+            for x in 0..WIDTH {
+                buffer[y * WIDTH + x] = round as u32;
+            }
+        }
+    });
+    let fast = measure(frame_bytes, |round| {
+        Canvas::new(buffer, WIDTH, HEIGHT).fill_rect(0, 0, WIDTH, HEIGHT, round as u32);
+    });
+    results.push(format!("fill_rect   {:6.2} GB/s  naive {:6.2} GB/s", fast, naive));
+
+    let naive = measure(sprite_bytes, |_| {
+        for sy in 0..sprites_y {
+            for sx in 0..sprites_x {
+                naive_blit(buffer, sx * SPRITE, sy * SPRITE, sprite, SPRITE, SPRITE);
+            }
+        }
+    });
+    let fast = measure(sprite_bytes, |_| {
+        let mut canvas = Canvas::new(buffer, WIDTH, HEIGHT);
+
+        for sy in 0..sprites_y {
+            for sx in 0..sprites_x {
+                canvas.blit((sx * SPRITE) as i32, (sy * SPRITE) as i32, sprite, SPRITE, SPRITE);
+            }
+        }
+    });
+    results.push(format!("blit        {:6.2} GB/s  naive {:6.2} GB/s", fast, naive));
+
+    let naive = measure(sprite_bytes, |_| {
+        for sy in 0..sprites_y {
+            for sx in 0..sprites_x {
+                naive_blit_alpha(buffer, sx * SPRITE, sy * SPRITE, sprite, SPRITE, SPRITE);
+            }
+        }
+    });
+    let fast = measure(sprite_bytes, |_| {
+        let mut canvas = Canvas::new(buffer, WIDTH, HEIGHT);
+
+        for sy in 0..sprites_y {
+            for sx in 0..sprites_x {
+                canvas.blit_alpha((sx * SPRITE) as i32, (sy * SPRITE) as i32, sprite, SPRITE, SPRITE);
+            }
+        }
+    });
+    results.push(format!("blit_alpha  {:6.2} GB/s  naive {:6.2} GB/s", fast, naive));
+
+    results
+}
+
+fn main() {
+    let mut buffer: Vec<u32> = vec![0; WIDTH * HEIGHT];
+
+    // Radial gradient that fades out towards the edges
+    let sprite: Vec<u32> = (0..SPRITE * SPRITE).map(|i| {
+        let dx = (i % SPRITE) as f32 - SPRITE as f32 / 2.0;
+        let dy = (i / SPRITE) as f32 - SPRITE as f32 / 2.0;
+        let alpha = (255.0 - (dx * dx + dy * dy).sqrt() * 8.0).max(0.0).min(255.0) as u32;
+        (alpha << 24) | 0x40a0ff
+    }).collect();
+
+    let results = benchmark(&mut buffer, &sprite);
+
+    for line in results.iter() {
+        println!("{}", line);
+    }
+
+    let mut window = match Window::new("Draw - ESC to exit", WIDTH, HEIGHT, WindowOptions::default()) {
+        Ok(win) => win,
+        Err(err) => {
+            println!("Unable to create window {}", err);
+            return;
+        }
+    };
+
+    let mut frame = 0;
+
+    while window.is_open() && !window.is_key_down(Key::Escape) {
+        {
+            let mut canvas = Canvas::new(&mut buffer, WIDTH, HEIGHT);
+            let t = frame as f32 * 0.02;
+
+            canvas.clear(0x202030);
+
+            for (i, line) in results.iter().enumerate() {
+                canvas.text(8, (8 + i * FONT_HEIGHT * 2) as i32, line, 0xe0e0e0);
+            }
+
+            // Shapes inside of a clip rectangle that they partially leave
+            canvas.set_clip(40, 80, WIDTH - 80, HEIGHT - 120);
+            canvas.fill_rect(30, 70, 100, 60, 0x803030);
+
+            for i in 0..32 {
+                let a = t + i as f32 * 0.196;
+                let (cx, cy) = (WIDTH as f32 / 2.0, 220.0);
+                let (x, y) = (cx + a.cos() * 200.0, cy + a.sin() * 200.0);
+
+                if i % 2 == 0 {
+                    canvas.line(cx as i32, cy as i32, x as i32, y as i32, 0x60ff60);
+                } else {
+                    canvas.line_aa(cx, cy, x, y, 0xffffff);
+                }
+            }
+
+            let x = (t.sin() * 260.0) as i32 + (WIDTH / 2) as i32 - (SPRITE / 2) as i32;
+            canvas.blit_alpha(x, 180, &sprite, SPRITE, SPRITE);
+            canvas.text(x - 40, 250, "clipped text", 0xffff00);
+        }
+
+        window.update_with_buffer(&buffer).unwrap();
+        frame += 1;
+    }
+}
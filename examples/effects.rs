@@ -0,0 +1,71 @@
+extern crate minifb;
+
+use minifb::{Key, PostEffects, Scale, Window, WindowOptions};
+use std::time::Instant;
+
+const WIDTH: usize = 320;
+const HEIGHT: usize = 200;
+const FRAMES: usize = 300;
+
+// Measures how much the post effects add to presenting a frame scaled by 4 compared to the plain
+// scale. Every frame changes all pixels so each update scales the whole buffer. The effects are
+// only applied on X11, elsewhere all rows measure the plain update. Build with --release to get
+// meaningful numbers:
+//
+//   cargo run --release --example effects
+
+fn seconds(start: Instant) -> f64 {
+    let elapsed = start.elapsed();
+    elapsed.as_secs() as f64 + elapsed.subsec_nanos() as f64 / 1_000_000_000.0
+}
+
+fn main() {
+    let mut window = match Window::new("Effects - ESC to exit", WIDTH, HEIGHT,
+                                       WindowOptions {
+                                           scale: Scale::X4,
+                                           ..WindowOptions::default()
+                                       }) {
+        Ok(win) => win,
+        Err(err) => {
+            println!("Unable to create window {}", err);
+            return;
+        }
+    };
+
+    let effects = [
+        ("plain scale", PostEffects::default()),
+        ("scanlines", PostEffects { scanlines: 96, ..PostEffects::default() }),
+        ("shadow mask", PostEffects { shadow_mask: 64, ..PostEffects::default() }),
+        ("edge blend", PostEffects { edge_blend: true, ..PostEffects::default() }),
+        ("all", PostEffects { scanlines: 96, shadow_mask: 64, edge_blend: true }),
+    ];
+
+    let mut buffer: Vec<u32> = vec![0; WIDTH * HEIGHT];
+    let mut frame = 0;
+
+    for &(name, effect) in effects.iter() {
+        window.set_post_effects(effect);
+
+        let mut total = 0.0;
+
+        for _ in 0..FRAMES {
+            if !window.is_open() || window.is_key_down(Key::Escape) {
+                return;
+            }
+
+            for (i, pixel) in buffer.iter_mut().enumerate() {
+                let x = (i % WIDTH + frame) as u32;
+                let y = (i / WIDTH) as u32;
+                *pixel = ((x & 0xff) << 16) | ((y & 0xff) << 8) | ((x ^ y) & 0xff);
+            }
+
+            frame += 1;
+
+            let start = Instant::now();
+            window.update_with_buffer(&buffer).unwrap();
+            total += seconds(start);
+        }
+
+        println!("{:12} {:8.1} us per frame", name, total / FRAMES as f64 * 1e6);
+    }
+}
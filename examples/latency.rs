@@ -0,0 +1,66 @@
+extern crate minifb;
+
+use minifb::{Key, KeyRepeat, Window, WindowOptions};
+
+const WIDTH: usize = 640;
+const HEIGHT: usize = 360;
+
+// Flips the color of the window on every key press and prints the latency from the key press to
+// the frame showing it when Escape is pressed. Synthetic input from XTest works as well, under
+// Xvfb:
+//
+//   xvfb-run -a sh -c 'cargo run --release --example latency &
+//       sleep 2; for i in $(seq 500); do xdotool key space; sleep 0.01; done; xdotool key Escape; wait'
+
+fn main() {
+    let mut buffer: Vec<u32> = vec![0; WIDTH * HEIGHT];
+
+    let mut window = match Window::new("Latency - press keys, ESC to exit", WIDTH, HEIGHT,
+                                       WindowOptions::default()) {
+        Ok(win) => win,
+        Err(err) => {
+            println!("Unable to create window {}", err);
+            return;
+        }
+    };
+
+    window.set_latency_tracking(true);
+
+    let mut color = 0;
+
+    while window.is_open() && !window.is_key_down(Key::Escape) {
+        if let Some(keys) = window.get_keys_pressed(KeyRepeat::Yes) {
+            if !keys.is_empty() {
+                color ^= 0xffffff;
+            }
+        }
+
+        for pixel in buffer.iter_mut() {
+            *pixel = color;
+        }
+
+        window.update_with_buffer(&buffer).unwrap();
+    }
+
+    let histogram = match window.latency_histogram() {
+        Some(histogram) => histogram,
+        None => {
+            println!("Latency tracking isn't supported on this platform");
+            return;
+        }
+    };
+
+    println!("{} frames measured", histogram.count());
+
+    for &p in [0.5, 0.9, 0.99, 1.0].iter() {
+        if let Some(latency) = histogram.percentile(p) {
+            println!("{:5.1}%: {} ms", p * 100.0, latency);
+        }
+    }
+
+    for (latency, frames) in histogram.buckets.iter().enumerate() {
+        if *frames > 0 {
+            println!("{:4} ms: {}", latency, frames);
+        }
+    }
+}
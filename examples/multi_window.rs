@@ -0,0 +1,49 @@
+extern crate minifb;
+
+use minifb::{Window, Key, WindowOptions};
+
+const WIDTH: usize = 320;
+const HEIGHT: usize = 180;
+const WINDOW_COUNT: usize = 4;
+
+fn main() {
+    let mut buffers: Vec<Vec<u32>> = vec![vec![0; WIDTH * HEIGHT]; WINDOW_COUNT];
+    let mut windows: Vec<Window> = Vec::new();
+
+    for i in 0..WINDOW_COUNT {
+        let mut window = match Window::new(&format!("Window {} - Press ESC to exit", i), WIDTH, HEIGHT,
+                                           WindowOptions::default()) {
+            Ok(win) => win,
+            Err(err) => {
+                println!("Unable to create window {}", err);
+                return;
+            }
+        };
+
+        window.set_position(((i % 2) * (WIDTH + 20)) as isize, ((i / 2) * (HEIGHT + 40)) as isize);
+        windows.push(window);
+    }
+
+    let mut frame = 0u32;
+
+    while windows.iter().all(|w| w.is_open() && !w.is_key_down(Key::Escape)) {
+        for (i, buffer) in buffers.iter_mut().enumerate() {
+            let shade = (frame + (i as u32) * 64) & 0xff;
+            for (p, pixel) in buffer.iter_mut().enumerate() {
+                *pixel = (shade << 16) | ((p as u32 & 0xff) << 8) | (0xff - shade);
+            }
+        }
+
+        {
+            let mut updates: Vec<(&mut Window, &[u32])> = windows.iter_mut()
+                .zip(buffers.iter())
+                .map(|(w, b)| (w, &b[..]))
+                .collect();
+
+            // We unwrap here as we want this code to exit if it fails
+            Window::update_all_with_buffers(&mut updates).unwrap();
+        }
+
+        frame = frame.wrapping_add(1);
+    }
+}
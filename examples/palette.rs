@@ -0,0 +1,82 @@
+extern crate minifb;
+
+use minifb::{Key, KeyRepeat, Scale, Window, WindowOptions};
+use std::time::Instant;
+
+const WIDTH: usize = 320;
+const HEIGHT: usize = 200;
+
+// Color cycling: the indices are sent once and each frame only rotates the palette. When Escape
+// is pressed the average time of the updates is printed for both ways of showing the frames:
+// expanding the indices to 32-bit in Rust for update_with_buffer and update_with_palette.
+//
+//   cargo run --release --example palette
+
+fn seconds(start: Instant) -> f64 {
+    let elapsed = start.elapsed();
+    elapsed.as_secs() as f64 + elapsed.subsec_nanos() as f64 / 1_000_000_000.0
+}
+
+fn main() {
+    let mut window = match Window::new("Palette - SPACE to switch, ESC to exit", WIDTH, HEIGHT,
+                                       WindowOptions {
+                                           scale: Scale::X4,
+                                           ..WindowOptions::default()
+                                       }) {
+        Ok(win) => win,
+        Err(err) => {
+            println!("Unable to create window {}", err);
+            return;
+        }
+    };
+
+    // Rings around the center, each index is a band of color
+    let indices: Vec<u8> = (0..WIDTH * HEIGHT).map(|i| {
+        let dx = (i % WIDTH) as f32 - WIDTH as f32 / 2.0;
+        let dy = (i / WIDTH) as f32 - HEIGHT as f32 / 2.0;
+        ((dx * dx + dy * dy).sqrt() * 2.0) as u8
+    }).collect();
+
+    let mut palette: Vec<u32> = (0..256).map(|i| {
+        let t = i as f32 / 256.0 * 6.283;
+        let channel = |phase: f32| (((t + phase).sin() * 0.5 + 0.5) * 255.0) as u32;
+        (channel(0.0) << 16) | (channel(2.094) << 8) | channel(4.189)
+    }).collect();
+
+    let mut buffer: Vec<u32> = vec![0; WIDTH * HEIGHT];
+    let mut expand_in_rust = false;
+    let mut times = [(0.0, 0); 2];
+
+    window.set_palette(&palette).unwrap();
+    window.update_with_indexed(&indices).unwrap();
+
+    while window.is_open() && !window.is_key_down(Key::Escape) {
+        if window.is_key_pressed(Key::Space, KeyRepeat::No) {
+            expand_in_rust = !expand_in_rust;
+        }
+
+        palette.rotate_left(1);
+
+        let start = Instant::now();
+
+        if expand_in_rust {
+            for (pixel, index) in buffer.iter_mut().zip(indices.iter()) {
+                *pixel = palette[*index as usize];
+            }
+
+            window.update_with_buffer(&buffer).unwrap();
+        } else {
+            window.update_with_palette(&palette).unwrap();
+        }
+
+        let time = &mut times[expand_in_rust as usize];
+        time.0 += seconds(start);
+        time.1 += 1;
+    }
+
+    for &(name, (total, frames)) in [("update_with_palette", times[0]), ("expand + update_with_buffer", times[1])].iter() {
+        if frames > 0 {
+            println!("{:28} {:8.1} us per frame ({} frames)", name, total / frames as f64 * 1e6, frames);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+extern crate minifb;
+
+use minifb::{Window, WindowOptions};
+use std::time::Instant;
+
+const WIDTH: usize = 640;
+const HEIGHT: usize = 360;
+
+// Measures how long it takes until the first frame of a new window has been presented. On X11
+// update_with_buffer ends with a round-trip (the mouse position query) so the frame has been
+// processed by the server when it returns. As the display setup happens once per process run it
+// several times to get a stable number, with Xvfb:
+//
+//   for i in $(seq 10); do xvfb-run -a cargo run --release --example startup; done
+
+fn ms(start: Instant) -> f64 {
+    let elapsed = start.elapsed();
+    elapsed.as_secs() as f64 * 1000.0 + elapsed.subsec_nanos() as f64 / 1_000_000.0
+}
+
+fn main() {
+    let start = Instant::now();
+    let buffer: Vec<u32> = (0..WIDTH * HEIGHT).map(|i| (i as u32) * 0x010101).collect();
+
+    let mut window = match Window::new("Startup", WIDTH, HEIGHT, WindowOptions::default()) {
+        Ok(win) => win,
+        Err(err) => {
+            println!("Unable to create window {}", err);
+            return;
+        }
+    };
+
+    let opened = ms(start);
+
+    window.update_with_buffer(&buffer).unwrap();
+
+    println!("window opened: {:.2} ms, first frame presented: {:.2} ms", opened, ms(start));
+}
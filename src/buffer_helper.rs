@@ -1,5 +1,6 @@
 use error::Error;
 use Result;
+use {YuvFrame, YuvFormat, YuvMatrix, YuvRange};
 
 pub fn check_buffer_size(window_width: usize, window_height: usize, scale: usize, buffer: &[u32]) -> Result<()> {
     let buffer_size = buffer.len() * 4; // len is the number of entries so * 4 as we want bytes
@@ -13,3 +14,288 @@ pub fn check_buffer_size(window_width: usize, window_height: usize, scale: usize
         Ok(())
     }
 }
+
+pub fn check_buffer_stride(window_width: usize, window_height: usize, scale: usize,
+                           x: usize, y: usize, stride: usize, buffer: &[u32]) -> Result<()> {
+    let width = window_width / scale;
+    let height = window_height / scale;
+
+    if x.checked_add(width).map_or(true, |end| end > stride) {
+        let err = format!("Update failed because a {} pixels wide window at x {} doesn't fit within the stride of {} pixels",
+                           width, x, stride);
+        return Err(Error::UpdateFailed(err));
+    }
+
+    // x + width fits within the stride which is checked above
+    let required_len = if height == 0 {
+        Some(0)
+    } else {
+        y.checked_add(height - 1)
+            .and_then(|last_row| last_row.checked_mul(stride))
+            .and_then(|start| start.checked_add(x + width))
+    };
+
+    let required_len = match required_len {
+        Some(len) => len,
+        None => {
+            let err = format!("Update failed because the area at {} x {} with stride {} is outside of the addressable memory",
+                               x, y, stride);
+            return Err(Error::UpdateFailed(err));
+        }
+    };
+
+    if buffer.len() < required_len {
+        let err = format!("Update failed because input buffer is too small. Required size for {} x {} window ({}x scale) at {} x {} with stride {} is {} bytes but the size of the input buffer has the size {} bytes",
+                           window_width, window_height, scale, x, y, stride, required_len * 4, buffer.len() * 4);
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn check_region(window_width: usize, window_height: usize, scale: usize,
+                    x: usize, y: usize, width: usize, height: usize) -> Result<()> {
+    let buffer_width = window_width / scale;
+    let buffer_height = window_height / scale;
+
+    let inside = match (x.checked_add(width), y.checked_add(height)) {
+        (Some(x1), Some(y1)) => x1 <= buffer_width && y1 <= buffer_height,
+        _ => false,
+    };
+
+    if !inside {
+        let err = format!("Region {} x {} at {} x {} is outside of the {} x {} buffer",
+                           width, height, x, y, buffer_width, buffer_height);
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+// Copies the area used by a strided update into a tightly packed buffer for backends that can't read it directly
+#[cfg(not(minifb_x11))]
+pub fn pack_buffer_stride(window_width: usize, window_height: usize, scale: usize,
+                          x: usize, y: usize, stride: usize, buffer: &[u32]) -> Vec<u32> {
+    let width = window_width / scale;
+    let height = window_height / scale;
+    let mut packed = Vec::with_capacity(width * height);
+
+    for row in 0..height {
+        let start = ((y + row) * stride) + x;
+        packed.extend_from_slice(&buffer[start..start + width]);
+    }
+
+    packed
+}
+
+pub fn check_color_curves(red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+    if red.len() != 256 || green.len() != 256 || blue.len() != 256 {
+        let err = format!("Color curves must have 256 entries each but has {}, {} and {}",
+                          red.len(), green.len(), blue.len());
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn check_color_lut(size: usize, lut: &[u32]) -> Result<()> {
+    if size < 2 || size > 65 {
+        let err = format!("Color lut size {} is outside of the supported range (2 - 65)", size);
+        Err(Error::UpdateFailed(err))
+    } else if lut.len() < size * size * size {
+        let err = format!("Color lut of {} entries is too small for a {}^3 lut", lut.len(), size);
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn check_cursor_image(width: usize, height: usize, hot_x: usize, hot_y: usize, image: &[u32]) -> Result<()> {
+    let required_len = width.checked_mul(height);
+
+    if width == 0 || height == 0 || required_len.map_or(true, |len| image.len() < len) {
+        let err = format!("Cursor image of {} entries is too small for a {} x {} cursor", image.len(), width, height);
+        Err(Error::UpdateFailed(err))
+    } else if hot_x >= width || hot_y >= height {
+        let err = format!("Cursor hot spot {} x {} is outside of the {} x {} cursor", hot_x, hot_y, width, height);
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+fn check_plane(name: &str, plane: &[u8], stride: usize, row_size: usize, rows: usize) -> Result<()> {
+    if stride < row_size {
+        let err = format!("Stride {} of the {} plane is smaller than a row of {} bytes", stride, name, row_size);
+        Err(Error::UpdateFailed(err))
+    } else if rows > 0 && plane.len() < ((rows - 1) * stride) + row_size {
+        let err = format!("The {} plane of {} bytes is too small for {} rows of {} bytes with a stride of {}",
+                          name, plane.len(), rows, row_size, stride);
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn check_yuv_frame(window_width: usize, window_height: usize, scale: usize, frame: &YuvFrame) -> Result<()> {
+    let width = window_width / scale;
+    let height = window_height / scale;
+    let chroma_width = (width + 1) / 2;
+    let chroma_height = (height + 1) / 2;
+
+    let check_res = check_plane("Y", frame.y, frame.y_stride, width, height);
+    if check_res.is_err() {
+        return check_res;
+    }
+
+    match frame.format {
+        YuvFormat::I420 => {
+            let check_res = check_plane("U", frame.u, frame.u_stride, chroma_width, chroma_height);
+            if check_res.is_err() {
+                return check_res;
+            }
+
+            check_plane("V", frame.v, frame.v_stride, chroma_width, chroma_height)
+        }
+        YuvFormat::Nv12 => check_plane("UV", frame.u, frame.u_stride, chroma_width * 2, chroma_height),
+    }
+}
+
+// Factors of the YUV to RGB conversion (here and in X11MiniFB.c): the Y offset followed by the factors for Y, V to
+// red, U to green, V to green and U to blue in 2.13 fixed point
+pub fn yuv_coefficients(frame: &YuvFrame) -> [i16; 6] {
+    let (kr, kb) = match frame.matrix {
+        YuvMatrix::Bt601 => (0.299, 0.114),
+        YuvMatrix::Bt709 => (0.2126, 0.0722),
+    };
+    let kg = 1.0 - kr - kb;
+    let (offset, y_scale, c_scale) = match frame.range {
+        YuvRange::Limited => (16, 255.0 / 219.0, 255.0 / 224.0),
+        YuvRange::Full => (0, 1.0, 1.0),
+    };
+    let fixed = |value: f64| (value * 8192.0).round() as i16;
+
+    [offset,
+     fixed(y_scale),
+     fixed(2.0 * (1.0 - kr) * c_scale),
+     fixed(-2.0 * kb * (1.0 - kb) / kg * c_scale),
+     fixed(-2.0 * kr * (1.0 - kr) / kg * c_scale),
+     fixed(2.0 * (1.0 - kb) * c_scale)]
+}
+
+// Same steps as yuv_pixel in X11MiniFB.c so all backends show the same colors
+#[cfg(not(minifb_x11))]
+fn yuv_pixel(c: &[i16; 6], y: u8, u: u8, v: u8) -> u32 {
+    let mul = |value: i32, factor: i16| (value * factor as i32) >> 16;
+    let luma = mul((y as i32 - c[0] as i32) << 7, c[1]);
+    let u = (u as i32 - 128) << 7;
+    let v = (v as i32 - 128) << 7;
+
+    let r = (luma + mul(v, c[2]) + 8) >> 4;
+    let g = (luma + mul(u, c[3]) + mul(v, c[4]) + 8) >> 4;
+    let b = (luma + mul(u, c[5]) + 8) >> 4;
+
+    let clamp = |value: i32| if value < 0 { 0 } else if value > 255 { 255 } else { value as u32 };
+
+    (clamp(r) << 16) | (clamp(g) << 8) | clamp(b)
+}
+
+pub fn check_palette(palette: &[u32]) -> Result<()> {
+    if palette.len() > 256 {
+        let err = format!("The palette has {} colors but at most 256 can be set", palette.len());
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn check_indexed_buffer(window_width: usize, window_height: usize, scale: usize, indices: &[u8]) -> Result<()> {
+    let required_len = (window_width / scale) * (window_height / scale);
+
+    if indices.len() < required_len {
+        let err = format!("Update failed because the indexed buffer is too small. Required size for {} x {} window ({}x scale) is {} bytes but the buffer has {} bytes",
+                           window_width, window_height, scale, required_len, indices.len());
+        Err(Error::UpdateFailed(err))
+    } else {
+        Ok(())
+    }
+}
+
+pub fn no_indexed_frame() -> Error {
+    Error::UpdateFailed("There is no indexed frame to show with the palette, see update_with_indexed".to_owned())
+}
+
+///
+/// Palette and copy of the last indexed frame for the backends that expand indexed frames to
+/// 0RGB before presenting them
+///
+#[cfg(not(minifb_x11))]
+#[derive(Debug)]
+pub struct IndexedFrame {
+    palette: Vec<u32>,
+    indices: Vec<u8>,
+}
+
+#[cfg(not(minifb_x11))]
+impl IndexedFrame {
+    pub fn new() -> IndexedFrame {
+        IndexedFrame {
+            palette: vec![0; 256],
+            indices: Vec::new(),
+        }
+    }
+
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let check_res = check_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        self.palette[..palette.len()].copy_from_slice(palette);
+
+        Ok(())
+    }
+
+    /// Keeps a copy of the indices of the window sized frame and returns them expanded
+    pub fn expand(&mut self, window_width: usize, window_height: usize, scale: usize, indices: &[u8]) -> Vec<u32> {
+        let len = (window_width / scale) * (window_height / scale);
+
+        self.indices.clear();
+        self.indices.extend_from_slice(&indices[..len]);
+        self.expand_cached().unwrap()
+    }
+
+    /// The last frame expanded with the current palette
+    pub fn expand_cached(&self) -> Option<Vec<u32>> {
+        if self.indices.is_empty() {
+            return None;
+        }
+
+        Some(self.indices.iter().map(|&i| self.palette[i as usize]).collect())
+    }
+}
+
+// Converts a YUV frame to a tightly packed 0RGB buffer for backends that can't convert it while presenting
+#[cfg(not(minifb_x11))]
+pub fn pack_yuv_frame(window_width: usize, window_height: usize, scale: usize, frame: &YuvFrame) -> Vec<u32> {
+    let width = window_width / scale;
+    let height = window_height / scale;
+    let c = yuv_coefficients(frame);
+    let mut packed = Vec::with_capacity(width * height);
+
+    for y in 0..height {
+        let luma = &frame.y[y * frame.y_stride..];
+        let u_row = &frame.u[(y / 2) * frame.u_stride..];
+
+        for x in 0..width {
+            let (u, v) = match frame.format {
+                YuvFormat::I420 => (u_row[x / 2], frame.v[((y / 2) * frame.v_stride) + (x / 2)]),
+                YuvFormat::Nv12 => (u_row[(x / 2) * 2], u_row[((x / 2) * 2) + 1]),
+            };
+
+            packed.push(yuv_pixel(&c, luma[x], u, v));
+        }
+    }
+
+    packed
+}
@@ -0,0 +1,655 @@
+//!
+//! Drawing primitives for the 0RGB buffers given to `Window::update_with_buffer`: fills, blits,
+//! alpha blits, lines and text with a built-in 8x8 font. Everything is clipped to the buffer and
+//! to an optional clip rectangle, see `Canvas`.
+//!
+//! Fills and blits work a row at a time so they compile to the same stores and copies as
+//! `memset`/`memcpy`. Alpha blits blend four pixels at a time with SSE2 where available.
+//!
+
+use std::cmp;
+use std::fmt;
+
+/// Width of a character of the built-in font in pixels
+pub const FONT_WIDTH: usize = 8;
+/// Height of a character (and of a line of text) of the built-in font in pixels
+pub const FONT_HEIGHT: usize = 8;
+
+///
+/// Draws into a 0RGB buffer of `width` x `height` pixels, such as the one passed to
+/// `Window::update_with_buffer`. Positions are signed so shapes may be partially (or entirely)
+/// outside of the buffer, only the part inside of the clip rectangle is drawn.
+///
+/// # Examples
+///
+/// ```ignore
+/// let mut buffer = vec![0u32; 640 * 360];
+///
+/// {
+///     let mut canvas = Canvas::new(&mut buffer, 640, 360);
+///     canvas.clear(0x202020);
+///     canvas.fill_rect(10, 10, 100, 50, 0xff0000);
+///     canvas.line_aa(0.0, 0.0, 639.0, 359.0, 0xffffff);
+///     canvas.text(10, 70, "Hello minifb", 0xffff00);
+/// }
+///
+/// window.update_with_buffer(&buffer).unwrap();
+/// ```
+///
+pub struct Canvas<'a> {
+    buffer: &'a mut [u32],
+    width: usize,
+    height: usize,
+    stride: usize,
+    // Clip rectangle as x0, y0, x1, y1 (exclusive), always within the buffer
+    clip: (usize, usize, usize, usize),
+}
+
+// Part of a rectangle that is inside of the clip rectangle and where it starts in the source
+struct Clipped {
+    x: usize,
+    y: usize,
+    width: usize,
+    height: usize,
+    src_x: usize,
+    src_y: usize,
+}
+
+impl<'a> Canvas<'a> {
+    ///
+    /// Creates a canvas for a tightly packed buffer of `width` x `height` pixels
+    ///
+    pub fn new(buffer: &'a mut [u32], width: usize, height: usize) -> Canvas<'a> {
+        Self::with_stride(buffer, width, height, width)
+    }
+
+    ///
+    /// Creates a canvas for a buffer where rows start `stride` pixels apart
+    ///
+    pub fn with_stride(buffer: &'a mut [u32], width: usize, height: usize, stride: usize) -> Canvas<'a> {
+        assert!(width <= stride, "width {} is larger than the stride {}", width, stride);
+        assert!(height == 0 || buffer.len() >= ((height - 1) * stride) + width,
+                "buffer of {} pixels is too small for {} x {} with a stride of {}",
+                buffer.len(), width, height, stride);
+
+        Canvas {
+            buffer: buffer,
+            width: width,
+            height: height,
+            stride: stride,
+            clip: (0, 0, width, height),
+        }
+    }
+
+    /// Width of the canvas in pixels
+    pub fn width(&self) -> usize {
+        self.width
+    }
+
+    /// Height of the canvas in pixels
+    pub fn height(&self) -> usize {
+        self.height
+    }
+
+    ///
+    /// Restricts drawing to a rectangle of the canvas. The rectangle is clipped to the canvas.
+    ///
+    pub fn set_clip(&mut self, x: i32, y: i32, width: usize, height: usize) {
+        let x0 = clamp(x as i64, self.width);
+        let y0 = clamp(y as i64, self.height);
+        let x1 = clamp(x as i64 + width as i64, self.width);
+        let y1 = clamp(y as i64 + height as i64, self.height);
+
+        self.clip = (x0, y0, cmp::max(x0, x1), cmp::max(y0, y1));
+    }
+
+    ///
+    /// Allows drawing to the whole canvas again
+    ///
+    pub fn reset_clip(&mut self) {
+        self.clip = (0, 0, self.width, self.height);
+    }
+
+    // Clips a rectangle at x, y and returns the visible part and where it starts in the rectangle
+    fn clip_rect(&self, x: i32, y: i32, width: usize, height: usize) -> Option<Clipped> {
+        let (cx0, cy0, cx1, cy1) = self.clip;
+        let x0 = cmp::max(x as i64, cx0 as i64);
+        let y0 = cmp::max(y as i64, cy0 as i64);
+        let x1 = cmp::min(x as i64 + width as i64, cx1 as i64);
+        let y1 = cmp::min(y as i64 + height as i64, cy1 as i64);
+
+        if x0 >= x1 || y0 >= y1 {
+            return None;
+        }
+
+        Some(Clipped {
+            x: x0 as usize,
+            y: y0 as usize,
+            width: (x1 - x0) as usize,
+            height: (y1 - y0) as usize,
+            src_x: (x0 - x as i64) as usize,
+            src_y: (y0 - y as i64) as usize,
+        })
+    }
+
+    #[inline]
+    fn row_mut(&mut self, x: usize, y: usize, width: usize) -> &mut [u32] {
+        let start = (y * self.stride) + x;
+        &mut self.buffer[start..start + width]
+    }
+
+    ///
+    /// Fills the clip rectangle (the whole canvas unless a clip has been set) with `color`
+    ///
+    pub fn clear(&mut self, color: u32) {
+        let (x0, y0, x1, y1) = self.clip;
+
+        // A packed buffer without a clip is filled in one go
+        if self.stride == self.width && self.clip == (0, 0, self.width, self.height) {
+            let len = self.width * self.height;
+            fill(&mut self.buffer[..len], color);
+            return;
+        }
+
+        self.fill_rect(x0 as i32, y0 as i32, x1 - x0, y1 - y0, color);
+    }
+
+    ///
+    /// Fills a rectangle with `color`
+    ///
+    pub fn fill_rect(&mut self, x: i32, y: i32, width: usize, height: usize, color: u32) {
+        let rect = match self.clip_rect(x, y, width, height) {
+            Some(rect) => rect,
+            None => return,
+        };
+
+        for y in rect.y..rect.y + rect.height {
+            fill(self.row_mut(rect.x, y, rect.width), color);
+        }
+    }
+
+    ///
+    /// Sets a single pixel if it's inside of the clip rectangle
+    ///
+    #[inline]
+    pub fn set_pixel(&mut self, x: i32, y: i32, color: u32) {
+        self.set_pixel_i64(x as i64, y as i64, color);
+    }
+
+    // Blends color over a pixel with a coverage of 0 - 255
+    #[inline]
+    fn blend_pixel(&mut self, x: i64, y: i64, color: u32, coverage: u32) {
+        let (cx0, cy0, cx1, cy1) = self.clip;
+
+        if x >= cx0 as i64 && y >= cy0 as i64 && x < cx1 as i64 && y < cy1 as i64 {
+            let pixel = &mut self.buffer[(y as usize * self.stride) + x as usize];
+            *pixel = blend(*pixel, color, coverage);
+        }
+    }
+
+    ///
+    /// Copies `src` (a packed buffer of `src_width` x `src_height` pixels) to x, y
+    ///
+    pub fn blit(&mut self, x: i32, y: i32, src: &[u32], src_width: usize, src_height: usize) {
+        assert!(src.len() >= src_width * src_height,
+                "source of {} pixels is too small for {} x {}", src.len(), src_width, src_height);
+
+        let rect = match self.clip_rect(x, y, src_width, src_height) {
+            Some(rect) => rect,
+            None => return,
+        };
+
+        for row in 0..rect.height {
+            let start = ((rect.src_y + row) * src_width) + rect.src_x;
+            copy(self.row_mut(rect.x, rect.y + row, rect.width), &src[start..start + rect.width]);
+        }
+    }
+
+    ///
+    /// Draws `src` (a packed ARGB buffer of `src_width` x `src_height` pixels) over the canvas at
+    /// x, y using the alpha in the top byte of each pixel. An alpha of 255 is opaque, 0 leaves the
+    /// canvas unchanged. The result is written as 0RGB.
+    ///
+    pub fn blit_alpha(&mut self, x: i32, y: i32, src: &[u32], src_width: usize, src_height: usize) {
+        assert!(src.len() >= src_width * src_height,
+                "source of {} pixels is too small for {} x {}", src.len(), src_width, src_height);
+
+        let rect = match self.clip_rect(x, y, src_width, src_height) {
+            Some(rect) => rect,
+            None => return,
+        };
+
+        for row in 0..rect.height {
+            let start = ((rect.src_y + row) * src_width) + rect.src_x;
+            blend_row(self.row_mut(rect.x, rect.y + row, rect.width), &src[start..start + rect.width]);
+        }
+    }
+
+    ///
+    /// Draws a one pixel wide line from x0, y0 to x1, y1 (both included) with Bresenham's
+    /// algorithm. Only the steps of the line that are inside of the clip rectangle are walked.
+    ///
+    pub fn line(&mut self, x0: i32, y0: i32, x1: i32, y1: i32, color: u32) {
+        if y0 == y1 {
+            let x = cmp::min(x0, x1);
+            let width = (x1 as i64 - x0 as i64).abs() as usize + 1;
+            return self.fill_rect(x, y0, width, 1, color);
+        }
+
+        if x0 == x1 {
+            let y = cmp::min(y0, y1);
+            let height = (y1 as i64 - y0 as i64).abs() as usize + 1;
+            return self.fill_rect(x0, y, 1, height, color);
+        }
+
+        let (cx0, cy0, cx1, cy1) = self.clip;
+        let (cx0, cy0, cx1, cy1) = (cx0 as i64, cy0 as i64, cx1 as i64, cy1 as i64);
+        let (x0, y0, x1, y1) = (x0 as i64, y0 as i64, x1 as i64, y1 as i64);
+
+        if cmp::max(x0, x1) < cx0 || cmp::min(x0, x1) >= cx1 ||
+           cmp::max(y0, y1) < cy0 || cmp::min(y0, y1) >= cy1 {
+            return;
+        }
+
+        // Walk along the major axis. The minor coordinate of step i is the rounded
+        // minor0 + i * d_minor / d_major which can be computed directly for the first visible step.
+        let steep = (y1 - y0).abs() > (x1 - x0).abs();
+        let (major0, major1, minor0, minor1, major_min, major_max) = if steep {
+            (y0, y1, x0, x1, cy0, cy1)
+        } else {
+            (x0, x1, y0, y1, cx0, cx1)
+        };
+
+        let d_major = (major1 - major0).abs();
+        let d_minor = (minor1 - minor0).abs();
+        let s_major = if major1 > major0 { 1 } else { -1 };
+        let s_minor = if minor1 > minor0 { 1 } else { -1 };
+
+        let (first, last) = if s_major > 0 {
+            (major_min - major0, major_max - 1 - major0)
+        } else {
+            (major0 - (major_max - 1), major0 - major_min)
+        };
+
+        let first = cmp::max(first, 0);
+        let last = cmp::min(last, d_major);
+
+        let mut num = (first * 2 * d_minor) + d_major;
+        let mut minor = minor0 + (s_minor * (num / (2 * d_major)));
+        num %= 2 * d_major;
+
+        for i in first..last + 1 {
+            let major = major0 + (s_major * i);
+
+            if steep {
+                self.set_pixel_i64(minor, major, color);
+            } else {
+                self.set_pixel_i64(major, minor, color);
+            }
+
+            num += 2 * d_minor;
+
+            if num >= 2 * d_major {
+                num -= 2 * d_major;
+                minor += s_minor;
+            }
+        }
+    }
+
+    #[inline]
+    fn set_pixel_i64(&mut self, x: i64, y: i64, color: u32) {
+        let (cx0, cy0, cx1, cy1) = self.clip;
+
+        if x >= cx0 as i64 && y >= cy0 as i64 && x < cx1 as i64 && y < cy1 as i64 {
+            self.buffer[(y as usize * self.stride) + x as usize] = color;
+        }
+    }
+
+    ///
+    /// Draws an anti-aliased line from x0, y0 to x1, y1 with Xiaolin Wu's algorithm. Pixel
+    /// centers are at integer coordinates. The line is blended over the canvas.
+    ///
+    pub fn line_aa(&mut self, x0: f32, y0: f32, x1: f32, y1: f32, color: u32) {
+        let steep = (y1 - y0).abs() > (x1 - x0).abs();
+
+        let (mut x0, mut y0, mut x1, mut y1) = if steep { (y0, x0, y1, x1) } else { (x0, y0, x1, y1) };
+
+        if x0 > x1 {
+            ::std::mem::swap(&mut x0, &mut x1);
+            ::std::mem::swap(&mut y0, &mut y1);
+        }
+
+        let dx = x1 - x0;
+        let gradient = if dx == 0.0 { 1.0 } else { (y1 - y0) / dx };
+
+        // The steps outside of the clip rectangle along the major axis are skipped
+        let (major_min, major_max) = if steep {
+            (self.clip.1 as i64, self.clip.3 as i64)
+        } else {
+            (self.clip.0 as i64, self.clip.2 as i64)
+        };
+
+        // First end point
+        let x_end = x0.round();
+        let y_end = y0 + gradient * (x_end - x0);
+        let x_gap = 1.0 - fract(x0 + 0.5);
+        let x_first = x_end as i64;
+        let y_first = y_end.floor() as i64;
+
+        self.plot_aa(steep, x_first, y_first, color, (1.0 - fract(y_end)) * x_gap);
+        self.plot_aa(steep, x_first, y_first + 1, color, fract(y_end) * x_gap);
+
+        let y_start = y_end;
+
+        // Second end point
+        let x_end = x1.round();
+        let y_end = y1 + gradient * (x_end - x1);
+        let x_gap = fract(x1 + 0.5);
+        let x_last = x_end as i64;
+        let y_last = y_end.floor() as i64;
+
+        if x_last != x_first {
+            self.plot_aa(steep, x_last, y_last, color, (1.0 - fract(y_end)) * x_gap);
+            self.plot_aa(steep, x_last, y_last + 1, color, fract(y_end) * x_gap);
+        }
+
+        // Computed from the start for each step so skipped steps don't change the result
+        for x in cmp::max(x_first + 1, major_min)..cmp::min(x_last, major_max) {
+            let inter_y = y_start + gradient * (x - x_first) as f32;
+            let y = inter_y.floor();
+            let f = inter_y - y;
+
+            self.plot_aa(steep, x, y as i64, color, 1.0 - f);
+            self.plot_aa(steep, x, y as i64 + 1, color, f);
+        }
+    }
+
+    #[inline]
+    fn plot_aa(&mut self, steep: bool, x: i64, y: i64, color: u32, coverage: f32) {
+        let coverage = (coverage * 255.0 + 0.5) as u32;
+
+        if coverage == 0 {
+            return;
+        }
+
+        if steep {
+            self.blend_pixel(y, x, color, cmp::min(coverage, 255));
+        } else {
+            self.blend_pixel(x, y, color, cmp::min(coverage, 255));
+        }
+    }
+
+    ///
+    /// Draws `text` with the built-in 8x8 font with its top left corner at x, y. Characters
+    /// outside of printable ASCII are drawn as '?' and '\n' starts a new line. Only the set pixels
+    /// of the glyphs are drawn.
+    ///
+    pub fn text(&mut self, x: i32, y: i32, text: &str, color: u32) {
+        let mut cx = x as i64;
+        let mut cy = y as i64;
+
+        for c in text.chars() {
+            if c == '\n' {
+                cx = x as i64;
+                cy += FONT_HEIGHT as i64;
+                continue;
+            }
+
+            self.glyph(cx, cy, c, color);
+            cx += FONT_WIDTH as i64;
+        }
+    }
+
+    fn glyph(&mut self, x: i64, y: i64, c: char, color: u32) {
+        if x < i32::min_value() as i64 || x > i32::max_value() as i64 ||
+           y < i32::min_value() as i64 || y > i32::max_value() as i64 {
+            return;
+        }
+
+        let rect = match self.clip_rect(x as i32, y as i32, FONT_WIDTH, FONT_HEIGHT) {
+            Some(rect) => rect,
+            None => return,
+        };
+
+        let code = c as usize;
+        let glyph = if code >= 32 && code < 127 { &FONT[code - 32] } else { &FONT['?' as usize - 32] };
+
+        for row in 0..rect.height {
+            let bits = glyph[rect.src_y + row] >> rect.src_x;
+            let line = self.row_mut(rect.x, rect.y + row, rect.width);
+
+            for (col, pixel) in line.iter_mut().enumerate() {
+                if (bits >> col) & 1 != 0 {
+                    *pixel = color;
+                }
+            }
+        }
+    }
+}
+
+impl<'a> fmt::Debug for Canvas<'a> {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Canvas")
+            .field("width", &self.width)
+            .field("height", &self.height)
+            .field("stride", &self.stride)
+            .field("clip", &self.clip)
+            .finish()
+    }
+}
+
+#[inline]
+fn clamp(value: i64, max: usize) -> usize {
+    cmp::min(cmp::max(value, 0), max as i64) as usize
+}
+
+#[inline]
+fn fract(value: f32) -> f32 {
+    value - value.floor()
+}
+
+// Written as a plain loop so it's vectorized like memset
+#[inline]
+fn fill(row: &mut [u32], color: u32) {
+    for pixel in row.iter_mut() {
+        *pixel = color;
+    }
+}
+
+// Inlined instead of calling memcpy as rows of sprites are often too short to make up for the call
+#[inline]
+fn copy(row: &mut [u32], src: &[u32]) {
+    for (pixel, s) in row.iter_mut().zip(src.iter()) {
+        *pixel = *s;
+    }
+}
+
+// Source over with an alpha of 0 - 255. (t + (t >> 8)) >> 8 divides by 255 (rounded) and is
+// used by the SIMD version as well so both give the same result.
+#[inline]
+fn blend(dest: u32, src: u32, alpha: u32) -> u32 {
+    let inv = 255 - alpha;
+    let mut out = 0;
+
+    for shift in [0, 8, 16].iter() {
+        let s = (src >> shift) & 0xff;
+        let d = (dest >> shift) & 0xff;
+        let t = (s * alpha) + (d * inv) + 128;
+        out |= ((t + (t >> 8)) >> 8) << shift;
+    }
+
+    out
+}
+
+fn blend_row_scalar(dest: &mut [u32], src: &[u32]) {
+    for (d, s) in dest.iter_mut().zip(src.iter()) {
+        let alpha = *s >> 24;
+
+        if alpha == 255 {
+            *d = *s & 0xffffff;
+        } else if alpha != 0 {
+            *d = blend(*d, *s, alpha);
+        }
+    }
+}
+
+#[cfg(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2"))]
+fn blend_row(dest: &mut [u32], src: &[u32]) {
+    #[cfg(target_arch = "x86")]
+    use std::arch::x86::*;
+    #[cfg(target_arch = "x86_64")]
+    use std::arch::x86_64::*;
+
+    let len = cmp::min(dest.len(), src.len());
+    let mut i = 0;
+
+    unsafe {
+        let zero = _mm_setzero_si128();
+        let alpha_mask = _mm_set1_epi32(0xff000000u32 as i32);
+        let rgb_mask = _mm_set1_epi32(0x00ffffff);
+        let c255 = _mm_set1_epi16(255);
+        let c128 = _mm_set1_epi16(128);
+
+        while i + 4 <= len {
+            let sp = src.as_ptr().offset(i as isize) as *const __m128i;
+            let dp = dest.as_mut_ptr().offset(i as isize) as *mut __m128i;
+            let s = _mm_loadu_si128(sp);
+            let alpha = _mm_and_si128(s, alpha_mask);
+
+            // Runs of opaque or transparent pixels are common in sprites and skip the blending
+            if _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xffff {
+                _mm_storeu_si128(dp, _mm_and_si128(s, rgb_mask));
+            } else if _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) != 0xffff {
+                let d = _mm_loadu_si128(dp);
+
+                // Two pixels per register as 16-bit B, G, R, A with the alpha copied to all lanes
+                let s_lo = _mm_unpacklo_epi8(s, zero);
+                let s_hi = _mm_unpackhi_epi8(s, zero);
+                let d_lo = _mm_unpacklo_epi8(d, zero);
+                let d_hi = _mm_unpackhi_epi8(d, zero);
+                let a_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_lo, 0xff), 0xff);
+                let a_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_hi, 0xff), 0xff);
+
+                let t_lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s_lo, a_lo),
+                                                       _mm_mullo_epi16(d_lo, _mm_sub_epi16(c255, a_lo))), c128);
+                let t_hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(s_hi, a_hi),
+                                                       _mm_mullo_epi16(d_hi, _mm_sub_epi16(c255, a_hi))), c128);
+
+                let r_lo = _mm_srli_epi16(_mm_add_epi16(t_lo, _mm_srli_epi16(t_lo, 8)), 8);
+                let r_hi = _mm_srli_epi16(_mm_add_epi16(t_hi, _mm_srli_epi16(t_hi, 8)), 8);
+
+                _mm_storeu_si128(dp, _mm_and_si128(_mm_packus_epi16(r_lo, r_hi), rgb_mask));
+            }
+
+            i += 4;
+        }
+    }
+
+    blend_row_scalar(&mut dest[i..len], &src[i..len]);
+}
+
+#[cfg(not(all(any(target_arch = "x86", target_arch = "x86_64"), target_feature = "sse2")))]
+fn blend_row(dest: &mut [u32], src: &[u32]) {
+    blend_row_scalar(dest, src);
+}
+
+// 8x8 font for printable ASCII (32 - 126, plus DEL). Each byte is a row with the lowest bit as the
+// leftmost pixel.
+static FONT: [[u8; 8]; 96] = [
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00], // space
+    [0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00], // !
+    [0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00], // "
+    [0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00], // #
+    [0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00], // $
+    [0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00], // %
+    [0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00], // &
+    [0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00], // '
+    [0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00], // (
+    [0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00], // )
+    [0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00], // *
+    [0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00], // +
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06], // ,
+    [0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00], // -
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00], // .
+    [0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00], // /
+    [0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00], // 0
+    [0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00], // 1
+    [0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00], // 2
+    [0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00], // 3
+    [0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00], // 4
+    [0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00], // 5
+    [0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00], // 6
+    [0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00], // 7
+    [0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00], // 8
+    [0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00], // 9
+    [0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00], // :
+    [0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06], // ;
+    [0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00], // <
+    [0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00], // =
+    [0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00], // >
+    [0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00], // ?
+    [0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00], // @
+    [0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00], // A
+    [0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00], // B
+    [0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00], // C
+    [0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00], // D
+    [0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00], // E
+    [0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00], // F
+    [0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00], // G
+    [0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00], // H
+    [0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00], // I
+    [0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00], // J
+    [0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00], // K
+    [0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00], // L
+    [0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00], // M
+    [0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00], // N
+    [0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00], // O
+    [0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00], // P
+    [0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00], // Q
+    [0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00], // R
+    [0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00], // S
+    [0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00], // T
+    [0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00], // U
+    [0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00], // V
+    [0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00], // W
+    [0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00], // X
+    [0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00], // Y
+    [0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00], // Z
+    [0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00], // [
+    [0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00], // \
+    [0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00], // ]
+    [0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00], // ^
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF], // _
+    [0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00], // `
+    [0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00], // a
+    [0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00], // b
+    [0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00], // c
+    [0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00], // d
+    [0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00], // e
+    [0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00], // f
+    [0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F], // g
+    [0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00], // h
+    [0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00], // i
+    [0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E], // j
+    [0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00], // k
+    [0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00], // l
+    [0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00], // m
+    [0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00], // n
+    [0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00], // o
+    [0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F], // p
+    [0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78], // q
+    [0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00], // r
+    [0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00], // s
+    [0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00], // t
+    [0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00], // u
+    [0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00], // v
+    [0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00], // w
+    [0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00], // x
+    [0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F], // y
+    [0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00], // z
+    [0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00], // {
+    [0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00], // |
+    [0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00], // }
+    [0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00], // ~
+    [0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00], // DEL
+];
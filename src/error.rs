@@ -13,6 +13,12 @@ pub enum Error {
     WindowCreate(String),
     /// Unable to Update
     UpdateFailed(String),
+    /// Unable to create or open a frame ring
+    FrameRing(String),
+    /// Unable to start or write a trace
+    Trace(String),
+    /// The function isn't supported on this platform
+    NotSupported(String),
 }
 
 impl StdError for Error {
@@ -22,6 +28,9 @@ impl StdError for Error {
             Error::MenuExists(_) => "Menu already exists",
             Error::WindowCreate(_) => "Failed to create window",
             Error::UpdateFailed(_) => "Failed to Update",
+            Error::FrameRing(_) => "Frame ring failure",
+            Error::Trace(_) => "Trace failure",
+            Error::NotSupported(_) => "Not supported on this platform",
         }
     }
 
@@ -31,6 +40,9 @@ impl StdError for Error {
             Error::MenuExists(_) => None,
             Error::WindowCreate(_) => None,
             Error::UpdateFailed(_) => None,
+            Error::FrameRing(_) => None,
+            Error::Trace(_) => None,
+            Error::NotSupported(_) => None,
         }
     }
 }
@@ -50,6 +62,15 @@ impl fmt::Display for Error {
             Error::UpdateFailed(ref e) => {
                 write!(fmt, "{} {:?}", self.description(), e)
             }
+            Error::FrameRing(ref e) => {
+                write!(fmt, "{} {:?}", self.description(), e)
+            }
+            Error::Trace(ref e) => {
+                write!(fmt, "{} {:?}", self.description(), e)
+            }
+            Error::NotSupported(ref e) => {
+                write!(fmt, "{} {:?}", self.description(), e)
+            }
         }
     }
 }
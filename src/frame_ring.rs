@@ -0,0 +1,232 @@
+#![cfg(target_os = "linux")]
+
+//!
+//! Shared memory ring of frames so a window can show frames rendered by another process
+//! without sending them through a pipe. The producer creates a named ring and draws into its
+//! back buffer, the process owning the window opens it by name and presents the latest
+//! published frame directly from the shared memory.
+//!
+
+use error::Error;
+use Result;
+
+use std::os::raw::{c_void, c_char};
+use std::ffi::CString;
+use std::slice;
+use std::fmt;
+
+#[link(name = "rt")]
+extern {
+    fn mfb_frame_ring_create(name: *const c_char, width: i32, height: i32) -> *mut c_void;
+    fn mfb_frame_ring_open(name: *const c_char) -> *mut c_void;
+    fn mfb_frame_ring_info(ring: *mut c_void, width: *mut i32, height: *mut i32, stride: *mut i32);
+    fn mfb_frame_ring_back_buffer(ring: *mut c_void) -> *mut u32;
+    fn mfb_frame_ring_publish(ring: *mut c_void);
+    fn mfb_frame_ring_acquire(ring: *mut c_void, is_new: *mut i32) -> *const u32;
+    fn mfb_frame_ring_wait(ring: *mut c_void, timeout_ms: i32) -> i32;
+    fn mfb_frame_ring_close(ring: *mut c_void);
+}
+
+struct Ring {
+    handle: *mut c_void,
+    width: usize,
+    height: usize,
+    stride: usize,
+}
+
+// Each side only touches the frame it owns so the ring can be moved to another thread
+unsafe impl Send for Ring {}
+
+impl Ring {
+    fn new(handle: *mut c_void) -> Ring {
+        let mut width = 0;
+        let mut height = 0;
+        let mut stride = 0;
+
+        unsafe {
+            mfb_frame_ring_info(handle, &mut width, &mut height, &mut stride);
+        }
+
+        Ring {
+            handle: handle,
+            width: width as usize,
+            height: height as usize,
+            stride: stride as usize,
+        }
+    }
+}
+
+impl Drop for Ring {
+    fn drop(&mut self) {
+        unsafe {
+            mfb_frame_ring_close(self.handle);
+        }
+    }
+}
+
+impl fmt::Debug for Ring {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Ring")
+            .field("width", &self.width)
+            .field("height", &self.height)
+            .field("stride", &self.stride)
+            .finish()
+    }
+}
+
+fn shm_name(name: &str) -> Result<CString> {
+    let path = if name.starts_with('/') { name.to_owned() } else { format!("/{}", name) };
+
+    match CString::new(path) {
+        Ok(name) => Ok(name),
+        Err(_) => Err(Error::FrameRing(format!("Invalid frame ring name {}", name))),
+    }
+}
+
+///
+/// Writing side of a frame ring. Draw into `buffer_mut` and call `publish` to make the frame
+/// visible to the `FrameSource`. The ring is removed when the producer is dropped.
+///
+#[derive(Debug)]
+pub struct FrameProducer(Ring);
+
+impl FrameProducer {
+    ///
+    /// Creates a ring called `name` holding frames of `width` x `height` pixels (up to 16384
+    /// each). Fails if a ring with that name already exists.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut producer = FrameProducer::create("renderer", 640, 400).unwrap();
+    ///
+    /// loop {
+    ///     let stride = producer.stride();
+    ///     render(producer.buffer_mut(), stride);
+    ///     producer.publish();
+    /// }
+    /// ```
+    pub fn create(name: &str, width: usize, height: usize) -> Result<FrameProducer> {
+        let name = shm_name(name);
+        if name.is_err() {
+            return Err(name.unwrap_err());
+        }
+
+        let handle = unsafe { mfb_frame_ring_create(name.unwrap().as_ptr(), width as i32, height as i32) };
+
+        if handle.is_null() {
+            return Err(Error::FrameRing("Unable to create frame ring".to_owned()));
+        }
+
+        Ok(FrameProducer(Ring::new(handle)))
+    }
+
+    /// Width of the frames in pixels
+    pub fn width(&self) -> usize {
+        self.0.width
+    }
+
+    /// Height of the frames in pixels
+    pub fn height(&self) -> usize {
+        self.0.height
+    }
+
+    /// Number of pixels between the start of two rows in the buffer
+    pub fn stride(&self) -> usize {
+        self.0.stride
+    }
+
+    ///
+    /// The frame owned by the producer. The contents are undefined (it holds an old frame)
+    /// so the whole frame should be drawn before publishing it.
+    ///
+    pub fn buffer_mut(&mut self) -> &mut [u32] {
+        unsafe {
+            let buffer = mfb_frame_ring_back_buffer(self.0.handle);
+            slice::from_raw_parts_mut(buffer, self.0.stride * self.0.height)
+        }
+    }
+
+    ///
+    /// Makes the current frame the latest one and wakes up the consumer. This never waits for
+    /// the consumer: if it hasn't picked up the previous frame yet that frame is replaced.
+    ///
+    pub fn publish(&mut self) {
+        unsafe {
+            mfb_frame_ring_publish(self.0.handle);
+        }
+    }
+}
+
+///
+/// Reading side of a frame ring, presented with `Window::update_with_frame_source`
+///
+#[derive(Debug)]
+pub struct FrameSource(Ring);
+
+impl FrameSource {
+    ///
+    /// Opens the ring called `name` that has been created by a `FrameProducer`
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut source = FrameSource::open("renderer").unwrap();
+    ///
+    /// while window.is_open() {
+    ///     source.wait(16);
+    ///     window.update_with_frame_source(&mut source).unwrap();
+    /// }
+    /// ```
+    pub fn open(name: &str) -> Result<FrameSource> {
+        let name = shm_name(name);
+        if name.is_err() {
+            return Err(name.unwrap_err());
+        }
+
+        let handle = unsafe { mfb_frame_ring_open(name.unwrap().as_ptr()) };
+
+        if handle.is_null() {
+            return Err(Error::FrameRing("Unable to open frame ring".to_owned()));
+        }
+
+        Ok(FrameSource(Ring::new(handle)))
+    }
+
+    /// Width of the frames in pixels
+    pub fn width(&self) -> usize {
+        self.0.width
+    }
+
+    /// Height of the frames in pixels
+    pub fn height(&self) -> usize {
+        self.0.height
+    }
+
+    ///
+    /// Sleeps until a new frame has been published or `timeout_ms` has passed (a negative
+    /// timeout waits forever). Returns true if there is a new frame.
+    ///
+    pub fn wait(&mut self, timeout_ms: i32) -> bool {
+        unsafe { mfb_frame_ring_wait(self.0.handle, timeout_ms) != 0 }
+    }
+
+    ///
+    /// Takes the latest published frame. Returns the frame, its stride and if it's new since
+    /// the previous call or None if nothing has been published yet. The frame stays valid
+    /// and unchanged until the next call.
+    ///
+    pub fn acquire(&mut self) -> Option<(&[u32], usize, bool)> {
+        let mut is_new = 0;
+
+        unsafe {
+            let buffer = mfb_frame_ring_acquire(self.0.handle, &mut is_new);
+
+            if buffer.is_null() {
+                None
+            } else {
+                Some((slice::from_raw_parts(buffer, self.0.stride * self.0.height), self.0.stride, is_new != 0))
+            }
+        }
+    }
+}
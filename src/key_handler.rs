@@ -3,6 +3,10 @@ extern crate time;
 use std::mem;
 use {Key, KeyRepeat, InputCallback};
 
+// Flags of keys_pressed
+const KEY_PRESSED: u8 = 1;
+const KEY_REPEATED: u8 = 2;
+
 pub struct KeyHandler {
     pub key_callback: Option<Box<InputCallback>>,
     prev_time: f64,
@@ -12,6 +16,9 @@ pub struct KeyHandler {
     keys_down_duration: [f32; 512],
     key_repeat_delay: f32,
     key_repeat_rate: f32,
+    // Presses and repeats since the last update when the backend reports the repeats as events
+    repeat_events: bool,
+    keys_pressed: [u8; 512],
 }
 
 impl KeyHandler {
@@ -25,6 +32,25 @@ impl KeyHandler {
             delta_time: 0.0,
             key_repeat_delay: 0.250,
             key_repeat_rate: 0.050,
+            repeat_events: false,
+            keys_pressed: [0; 512],
+        }
+    }
+
+    ///
+    /// Key handler for backends that report each press and repeat with `set_key_pressed`.
+    /// The repeat then follows the events instead of the time between updates and the repeat
+    /// delay and rate aren't used. Used by the X11 and RFB backends.
+    ///
+    #[cfg(any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd"))]
+    pub fn with_repeat_events() -> KeyHandler {
+        KeyHandler {
+            repeat_events: true,
+            ..KeyHandler::new()
         }
     }
 
@@ -33,6 +59,17 @@ impl KeyHandler {
         self.keys[key as usize] = state;
     }
 
+    #[inline]
+    #[cfg(any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd"))]
+    pub fn set_key_pressed(&mut self, key: Key, repeat: bool) {
+        self.keys[key as usize] = true;
+        self.keys_pressed[key as usize] |= if repeat { KEY_REPEATED } else { KEY_PRESSED };
+    }
+
     pub fn get_keys(&self) -> Option<Vec<Key>> {
         let mut index: u16 = 0;
         let mut keys: Vec<Key> = Vec::new();
@@ -51,6 +88,12 @@ impl KeyHandler {
     }
 
     pub fn update(&mut self) {
+        if self.repeat_events {
+            self.keys_prev = self.keys;
+            self.keys_pressed = [0; 512];
+            return;
+        }
+
         let current_time = time::precise_time_s();
         let delta_time = (current_time - self.prev_time) as f32;
         self.prev_time = current_time;
@@ -79,7 +122,8 @@ impl KeyHandler {
         let mut keys: Vec<Key> = Vec::new();
 
         for i in self.keys.iter() {
-            if *i {
+            // Keys that have been pressed and released since the last update count as well
+            if *i || self.repeat_events {
                 unsafe {
                     if Self::key_pressed(self, index as usize, repeat) {
                         keys.push(mem::transmute(index as u8));
@@ -109,6 +153,11 @@ impl KeyHandler {
     }
 
     pub fn key_pressed(&self, index: usize, repeat: KeyRepeat) -> bool {
+        if self.repeat_events {
+            let pressed = self.keys_pressed[index];
+            return (pressed & KEY_PRESSED) != 0 || (repeat == KeyRepeat::Yes && (pressed & KEY_REPEATED) != 0);
+        }
+
         let t = self.keys_down_duration[index];
 
         if t == 0.0 {
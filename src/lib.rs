@@ -30,6 +30,210 @@ pub enum Scale {
     X32,
 }
 
+/// Selects where the scaling set with `Scale` is performed
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum ScaleMode {
+    /// The buffer is scaled up before it's sent to the display (default)
+    Client,
+    /// The unscaled buffer is sent and the display server scales it up using nearest filtering.
+    /// This reduces the amount of data being sent by the scale factor squared which helps a lot
+    /// with remote displays and large scale factors. Falls back to `Client` if not supported.
+    ServerNearest,
+    /// Same as `ServerNearest` but uses bilinear filtering
+    ServerBilinear,
+}
+
+/// Rotation (clockwise) of the buffer when it's shown in the window
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum Rotation {
+    /// The buffer is shown as is (default)
+    None,
+    /// Rotated 90 degrees. The window is as wide as the buffer is high and the other way around
+    Rotate90,
+    /// Rotated 180 degrees
+    Rotate180,
+    /// Rotated 270 degrees. The window is as wide as the buffer is high and the other way around
+    Rotate270,
+}
+
+/// How the window covers the screen, see `WindowOptions::fullscreen`
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum Fullscreen {
+    /// A normal window (default)
+    None,
+    /// Covers the monitor with the help of the window manager and asks compositors to not
+    /// composite it
+    Managed,
+    /// Covers the screen without involving the window manager at all and takes the keyboard
+    /// focus. Meant for kiosks and setups without a window manager
+    Exclusive,
+}
+
+///
+/// Effects applied to the buffer while it's scaled up, see `Window::set_post_effects`.
+/// All effects are off by default.
+///
+#[derive(PartialEq, Clone, Copy, Debug, Default)]
+pub struct PostEffects {
+    /// How much the lower half of each scaled row is darkened (0 is off and 255 is black)
+    pub scanlines: u8,
+    /// Strength of an aperture grille mask where every column shows mostly one of red, green
+    /// and blue (0 is off)
+    pub shadow_mask: u8,
+    /// Averages the first row and column of each scaled pixel with the pixel before it, which
+    /// softens the edges while the inside of the pixels stays sharp
+    pub edge_blend: bool,
+}
+
+///
+/// Position of the pointer after a motion event, see `Window::get_pointer_history`
+///
+#[derive(PartialEq, Clone, Copy, Debug, Default)]
+#[repr(C)]
+pub struct PointerSample {
+    /// Position in the buffer with sub-pixel precision
+    pub x: f32,
+    /// Position in the buffer with sub-pixel precision
+    pub y: f32,
+    /// Unaccelerated motion of the device (in device units) since the previous sample
+    pub raw_x: f32,
+    /// Unaccelerated motion of the device (in device units) since the previous sample
+    pub raw_y: f32,
+    /// Time of the event in milliseconds, as reported by the server
+    pub time: u32,
+}
+
+///
+/// Latencies from input events to the frame presented after them, see
+/// `Window::set_latency_tracking`.
+///
+#[derive(PartialEq, Clone, Debug)]
+pub struct LatencyHistogram {
+    /// Number of frames for each latency in milliseconds. The last bucket also counts all
+    /// longer latencies.
+    pub buckets: Vec<u32>,
+}
+
+impl LatencyHistogram {
+    /// Number of frames that have been measured
+    pub fn count(&self) -> u32 {
+        self.buckets.iter().sum()
+    }
+
+    ///
+    /// Latency in milliseconds that `fraction` (0.0 - 1.0) of the frames are at or below, or
+    /// None if nothing has been measured yet.
+    ///
+    pub fn percentile(&self, fraction: f32) -> Option<usize> {
+        let count = self.count();
+
+        if count == 0 {
+            return None;
+        }
+
+        let target = ((count as f32 * fraction).ceil() as u32).max(1);
+        let mut total = 0;
+
+        for (latency, frames) in self.buckets.iter().enumerate() {
+            total += *frames;
+
+            if total >= target {
+                return Some(latency);
+            }
+        }
+
+        Some(self.buckets.len() - 1)
+    }
+}
+
+/// Layout of the planes of a `YuvFrame`. Both are 4:2:0, the chroma planes have half the
+/// width and height of the frame (rounded up).
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum YuvFormat {
+    /// Separate U and V planes (also known as YUV420p), the usual output of software decoders
+    I420,
+    /// A single plane of interleaved U and V samples, the usual output of hardware decoders
+    /// and cameras
+    Nv12,
+}
+
+/// Matrix used to convert a `YuvFrame` to RGB
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum YuvMatrix {
+    /// BT.601, used by SD video and most webcams (default)
+    Bt601,
+    /// BT.709, used by HD video
+    Bt709,
+}
+
+/// Range of the values in a `YuvFrame`
+#[derive(PartialEq, Clone, Copy, Debug)]
+pub enum YuvRange {
+    /// Y is 16 - 235 and U, V 16 - 240 as used by most video (default)
+    Limited,
+    /// All values use 0 - 255, as in JPEG and some cameras
+    Full,
+}
+
+///
+/// A planar YUV 4:2:0 video frame of the size of the buffer, see `Window::update_with_yuv`.
+/// The strides are the number of bytes between the start of two rows of a plane.
+///
+#[derive(Clone, Copy, Debug)]
+pub struct YuvFrame<'a> {
+    /// Layout of the chroma planes
+    pub format: YuvFormat,
+    /// Conversion matrix
+    pub matrix: YuvMatrix,
+    /// Range of the values
+    pub range: YuvRange,
+    /// The Y plane with one sample per pixel
+    pub y: &'a [u8],
+    /// Stride of the Y plane
+    pub y_stride: usize,
+    /// The U plane for I420 or the interleaved U and V plane for NV12
+    pub u: &'a [u8],
+    /// Stride of the U (or UV) plane
+    pub u_stride: usize,
+    /// The V plane for I420, not used for NV12
+    pub v: &'a [u8],
+    /// Stride of the V plane
+    pub v_stride: usize,
+}
+
+impl<'a> YuvFrame<'a> {
+    /// An I420 frame using BT.601 with limited range
+    pub fn i420(y: &'a [u8], y_stride: usize, u: &'a [u8], u_stride: usize,
+                v: &'a [u8], v_stride: usize) -> YuvFrame<'a> {
+        YuvFrame {
+            format: YuvFormat::I420,
+            matrix: YuvMatrix::Bt601,
+            range: YuvRange::Limited,
+            y: y,
+            y_stride: y_stride,
+            u: u,
+            u_stride: u_stride,
+            v: v,
+            v_stride: v_stride,
+        }
+    }
+
+    /// An NV12 frame using BT.601 with limited range
+    pub fn nv12(y: &'a [u8], y_stride: usize, uv: &'a [u8], uv_stride: usize) -> YuvFrame<'a> {
+        YuvFrame {
+            format: YuvFormat::Nv12,
+            matrix: YuvMatrix::Bt601,
+            range: YuvRange::Limited,
+            y: y,
+            y_stride: y_stride,
+            u: uv,
+            u_stride: uv_stride,
+            v: &[],
+            v_stride: 0,
+        }
+    }
+}
+
 /// Used for is_key_pressed and get_keys_pressed() to indicated if repeat of presses is wanted
 #[derive(PartialEq, Clone, Copy, Debug)]
 pub enum KeyRepeat {
@@ -100,6 +304,17 @@ mod mouse_handler;
 mod buffer_helper;
 mod key_handler;
 mod window_flags;
+mod tiles;
+mod pool;
+pub use tiles::Tile;
+use tiles::Tiles;
+mod trace;
+pub use trace::{start_trace, stop_trace};
+pub mod draw;
+#[cfg(target_os = "linux")]
+mod frame_ring;
+#[cfg(target_os = "linux")]
+pub use frame_ring::{FrameProducer, FrameSource};
 //mod menu;
 //pub use menu::Menu as Menu;
 //pub use menu::MENU_KEY_COMMAND;
@@ -113,19 +328,83 @@ mod window_flags;
 use self::os::macos as imp;
 #[cfg(target_os = "windows")]
 use self::os::windows as imp;
-#[cfg(any(target_os="linux",
-    target_os="freebsd",
-    target_os="dragonfly",
-    target_os="netbsd",
-    target_os="openbsd"))]
+#[cfg(all(not(feature = "rfb"),
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
 use self::os::unix as imp;
+#[cfg(all(feature = "rfb",
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
+use self::os::rfb as imp;
 #[cfg(target_os = "redox")]
 use self::os::redox as imp;
 ///
 /// Window is used to open up a window. It's possible to optionally display a 32-bit buffer when
 /// the widow is set as non-resizable.
 ///
-pub struct Window(imp::Window);
+pub struct Window(imp::Window, Tiles);
+
+// X11 batches the updates of several windows, the other backends update them one at a time
+
+#[cfg(minifb_x11)]
+fn update_all_with_buffers(windows: &mut [(&mut Window, &[u32])]) -> Result<()> {
+    let mut imp_windows: Vec<(&mut imp::Window, &[u32])> = windows.iter_mut()
+        .map(|item| (&mut (item.0).0, item.1))
+        .collect();
+
+    imp::Window::update_all_with_buffers(&mut imp_windows)
+}
+
+#[cfg(not(minifb_x11))]
+fn update_all_with_buffers(windows: &mut [(&mut Window, &[u32])]) -> Result<()> {
+    for item in windows.iter_mut() {
+        let res = item.0.update_with_buffer(item.1);
+        if res.is_err() {
+            return res;
+        }
+    }
+
+    Ok(())
+}
+
+#[cfg(minifb_x11)]
+fn update_mirrored_with_buffer(windows: &mut [&mut Window], buffer: &[u32]) -> Result<()> {
+    let mut imp_windows: Vec<&mut imp::Window> = windows.iter_mut()
+        .map(|window| &mut window.0)
+        .collect();
+
+    imp::Window::update_mirrored_with_buffer(&mut imp_windows, buffer)
+}
+
+#[cfg(not(minifb_x11))]
+fn update_mirrored_with_buffer(windows: &mut [&mut Window], buffer: &[u32]) -> Result<()> {
+    for window in windows.iter_mut() {
+        let res = window.update_with_buffer(buffer);
+        if res.is_err() {
+            return res;
+        }
+    }
+
+    Ok(())
+}
+
+///
+/// The file descriptor of the X server connection. It becomes readable when there is new input
+/// for the windows, which is then processed with `dispatch_pending`. All windows share the same
+/// connection.
+///
+#[cfg(minifb_x11)]
+impl std::os::unix::io::AsRawFd for Window {
+    fn as_raw_fd(&self) -> std::os::unix::io::RawFd {
+        self.0.get_connection_fd()
+    }
+}
 
 impl fmt::Debug for Window {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
@@ -149,6 +428,33 @@ pub struct WindowOptions {
     pub resize: bool,
     /// Scale of the window that used in conjunction with update_with_buffer (default: X1)
     pub scale: Scale,
+    /// Keep a copy of the last frame on the display server. Redraws (after the window has been
+    /// covered, etc) are then handled without a new upload and only the rows that changed since
+    /// the previous update_with_buffer are sent. Useful for mostly static content and remote
+    /// displays. Currently only used on X11 (default: false)
+    pub retain: bool,
+    /// Where scaling of the buffer is done. Server side scaling is currently only supported
+    /// with X11 (using XRender) (default: Client)
+    pub scale_mode: ScaleMode,
+    /// Scale and upload the buffer a few rows at a time instead of keeping a full size scaled
+    /// copy of it. This keeps the memory used bounded for large scales (such as X16 and X32)
+    /// at the cost of doing the scaling when presenting. Currently only used on X11 with
+    /// client side scaling (default: false)
+    pub banded: bool,
+    /// Rotates the buffer when it's presented. The size given to `Window::new`, the buffers
+    /// and the mouse position all stay in the orientation of the buffer. Useful for displays
+    /// mounted in portrait. Currently only used on X11 (default: None)
+    pub rotation: Rotation,
+    /// Mirrors the buffer horizontally (after the rotation). Currently only used on X11
+    /// (default: false)
+    pub flip_x: bool,
+    /// Mirrors the buffer vertically (after the rotation). Currently only used on X11
+    /// (default: false)
+    pub flip_y: bool,
+    /// Shows the buffer fullscreen. The scale is then the largest integer scale that fits the
+    /// screen (`scale` isn't used) and the buffer is centered with black borders, so frames can
+    /// go to the screen without being scaled again. Currently only used on X11 (default: None)
+    pub fullscreen: Fullscreen,
 }
 
 impl Window {
@@ -185,7 +491,7 @@ impl Window {
     ///};
     /// ```
     pub fn new(name: &str, width: usize, height: usize, opts: WindowOptions) -> Result<Window> {
-        imp::Window::new(name, width, height, opts).map(Window)
+        imp::Window::new(name, width, height, opts).map(|window| Window(window, Tiles::new(width, height)))
     }
 
     ///
@@ -236,6 +542,252 @@ impl Window {
         self.0.update_with_buffer(buffer)
     }
 
+    ///
+    /// Updates the window with a part of a larger 32-bit pixel buffer. `stride` is the number of
+    /// pixels between the start of two rows in `buffer` and `x`, `y` is the upper left corner of
+    /// the area to show. The area has the same size as the buffer given to `update_with_buffer`.
+    /// This allows showing a viewport into a large canvas without first copying it into a
+    /// separate buffer (on X11 the area is read directly while scaling).
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let canvas: Vec<u32> = vec![0; 4096 * 4096];
+    ///
+    /// let mut window = Window::new("Test", 640, 400, WindowOptions::default()).unwrap();
+    ///
+    /// // Show the 640 x 400 area starting at 1000, 2000
+    /// window.update_with_buffer_stride(&canvas, 1000, 2000, 4096).unwrap();
+    /// ```
+    #[inline]
+    pub fn update_with_buffer_stride(&mut self, buffer: &[u32], x: usize, y: usize, stride: usize) -> Result<()> {
+        self.0.update_with_buffer_stride(buffer, x, y, stride)
+    }
+
+    ///
+    /// Updates the window with a YUV 4:2:0 frame (such as decoded video or camera output) of
+    /// the size of the buffer given to `update_with_buffer`.
+    ///
+    /// On X11 each row is converted (with SSE2 where available) right before it's scaled, so
+    /// there is no RGB copy of the frame and no extra pass over it. Rotated or flipped windows
+    /// and windows with `retain` or `banded` set convert the whole frame first. Other backends
+    /// currently convert the frame to a 32-bit buffer and present that.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// // 640 x 360 NV12 frame from a decoder, with 64 byte aligned rows
+    /// let frame = YuvFrame {
+    ///     matrix: YuvMatrix::Bt709,
+    ///     ..YuvFrame::nv12(&planes[..640 * 360], 640, &planes[640 * 360..], 640)
+    /// };
+    ///
+    /// window.update_with_yuv(&frame).unwrap();
+    /// ```
+    #[inline]
+    pub fn update_with_yuv(&mut self, frame: &YuvFrame) -> Result<()> {
+        self.0.update_with_yuv(frame)
+    }
+
+    ///
+    /// Sets the colors (0RGB) used by `update_with_indexed`, starting with index 0. There are
+    /// 256 entries, the ones after `palette` keep their colors (black at first). The new colors
+    /// are used for the next indexed frame, see `update_with_palette` to show them right away.
+    ///
+    #[inline]
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        self.0.set_palette(palette)
+    }
+
+    ///
+    /// Updates the window with a frame of 8-bit palette indices of the size of the buffer
+    /// given to `update_with_buffer`. The colors are set with `set_palette`.
+    ///
+    /// The window keeps a copy of the indices. On X11 only the rows that differ from the last
+    /// indexed frame are redrawn, and the palette lookup is done on each row right before it's
+    /// scaled so there is no 32-bit copy of the frame. Other backends currently expand the
+    /// frame to a 32-bit buffer and present that.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut indices: Vec<u8> = vec![0; 320 * 200];
+    ///
+    /// window.set_palette(&[0x000000, 0xff0000, 0x00ff00, 0x0000ff]).unwrap();
+    /// window.update_with_indexed(&indices).unwrap();
+    /// ```
+    #[inline]
+    pub fn update_with_indexed(&mut self, indices: &[u8]) -> Result<()> {
+        self.0.update_with_indexed(indices)
+    }
+
+    ///
+    /// Sets the palette like `set_palette` and shows the last frame given to
+    /// `update_with_indexed` with it, without sending the indices again. This is meant for
+    /// palette animation (color cycling, fades). Fails if there has been no indexed frame.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// // Cycle the colors 1 to 255
+    /// palette[1..].rotate_left(1);
+    /// window.update_with_palette(&palette).unwrap();
+    /// ```
+    #[inline]
+    pub fn update_with_palette(&mut self, palette: &[u32]) -> Result<()> {
+        self.0.update_with_palette(palette)
+    }
+
+    ///
+    /// Updates the window after the contents of a region has been scrolled. `buffer` should be
+    /// the full buffer (as given to `update_with_buffer`) where the pixels inside the region at
+    /// `x`, `y` with the size `width` x `height` already have been moved by `dx`, `dy` pixels
+    /// and the pixels scrolled in have been drawn. Everything outside of the region must be
+    /// unchanged since the last update.
+    ///
+    /// On X11 the pixels that are still visible are moved on the server and only the scrolled
+    /// in part is converted and uploaded, which is much cheaper than a full update when panning.
+    /// Other backends present the whole buffer, which gives the same result without the savings.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// // Scroll the log area one 8 pixel line up and draw the new line at the bottom
+    /// for y in 16..392 {
+    ///     for x in 0..640 {
+    ///         buffer[y * 640 + x] = buffer[(y + 8) * 640 + x];
+    ///     }
+    /// }
+    /// draw_line(&mut buffer[392 * 640..]);
+    ///
+    /// window.scroll_region(&buffer, 0, -8, 0, 16, 640, 384).unwrap();
+    /// ```
+    #[inline]
+    pub fn scroll_region(&mut self, buffer: &[u32], dx: isize, dy: isize,
+                         x: usize, y: usize, width: usize, height: usize) -> Result<()> {
+        self.0.scroll_region(buffer, dx, dy, x, y, width, height)
+    }
+
+    ///
+    /// Updates the window with the latest frame published to a `FrameSource`. The frame is
+    /// read directly from the shared memory. If no new frame has been published since the
+    /// previous call only the input is updated. Returns true if a new frame was presented.
+    /// The frames must have the same size as the buffer used with `update_with_buffer`.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut source = FrameSource::open("renderer").unwrap();
+    ///
+    /// while window.is_open() {
+    ///     source.wait(16);
+    ///     window.update_with_frame_source(&mut source).unwrap();
+    /// }
+    /// ```
+    #[cfg(target_os = "linux")]
+    pub fn update_with_frame_source(&mut self, source: &mut FrameSource) -> Result<bool> {
+        match source.acquire() {
+            Some((frame, stride, true)) => {
+                let res = self.0.update_with_buffer_stride(frame, 0, 0, stride);
+                if res.is_err() {
+                    return Err(res.unwrap_err());
+                }
+                Ok(true)
+            }
+            _ => {
+                self.0.update();
+                Ok(false)
+            }
+        }
+    }
+
+    ///
+    /// Updates several windows with their own buffers in one go. This works the same way as
+    /// calling `update_with_buffer` on each window but allows the backend to batch the work.
+    /// On X11 the buffers are scaled in parallel, all images are sent to the server before a
+    /// single flush and events for all windows are processed once. The mouse position is here
+    /// tracked from motion events so it isn't updated while the mouse is outside the window.
+    ///
+    /// Nothing is updated if any of the buffers is too small for its window.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut buffer_a: Vec<u32> = vec![0; 640 * 400];
+    /// let mut buffer_b: Vec<u32> = vec![0; 320 * 200];
+    ///
+    /// Window::update_all_with_buffers(&mut [(&mut window_a, &buffer_a),
+    ///                                       (&mut window_b, &buffer_b)]).unwrap();
+    /// ```
+    pub fn update_all_with_buffers(windows: &mut [(&mut Window, &[u32])]) -> Result<()> {
+        update_all_with_buffers(windows)
+    }
+
+    ///
+    /// Shows the same buffer in several windows, such as an operator window and a projector
+    /// window. The buffer is validated once and on X11 it's only scaled once for each distinct
+    /// window size (and orientation), the windows sharing it upload the same scaled image. The
+    /// uploads and event processing are batched as with `update_all_with_buffers`.
+    ///
+    /// All windows need to have the same size before scaling. Windows with a color transform
+    /// or post effects are scaled on their own.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut buffer: Vec<u32> = vec![0; 640 * 400];
+    ///
+    /// Window::update_mirrored_with_buffer(&mut [&mut operator, &mut projector], &buffer).unwrap();
+    /// ```
+    pub fn update_mirrored_with_buffer(windows: &mut [&mut Window], buffer: &[u32]) -> Result<()> {
+        update_mirrored_with_buffer(windows, buffer)
+    }
+
+    ///
+    /// Renders the frame with `render` called for tiles of `tile_size` x `tile_size` pixels (smaller
+    /// at the right and bottom edges) and presents it. The tiles are rendered in parallel on a
+    /// pool of threads that is kept between frames. On X11 each tile is scaled and uploaded as soon
+    /// as it's done so rendering, scaling and uploading overlap instead of being three passes over
+    /// the frame. The frame is kept between calls so each tile starts out with its previous
+    /// contents.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// window.update_with_tiles(64, |tile| {
+    ///     for y in 0..tile.height {
+    ///         let py = tile.y + y;
+    ///
+    ///         for (x, pixel) in tile.row_mut(y).iter_mut().enumerate() {
+    ///             *pixel = shade(tile.x + x, py);
+    ///         }
+    ///     }
+    /// }).unwrap();
+    /// ```
+    pub fn update_with_tiles<F>(&mut self, tile_size: usize, render: F) -> Result<()>
+        where F: Fn(&mut Tile) + Sync
+    {
+        if tile_size == 0 {
+            return Err(Error::UpdateFailed("Tile size must be at least 1".to_owned()));
+        }
+
+        let window = &mut self.0;
+        let mut tiled = true;
+
+        let frame = self.1.render(tile_size, &render, &mut |frame, x, y, width, height| {
+            if tiled {
+                tiled = window.update_tile(frame, x, y, width, height);
+            }
+        });
+
+        if tiled {
+            window.finish_tiles();
+            Ok(())
+        } else {
+            window.update_with_buffer(frame)
+        }
+    }
+
     ///
     /// Updates the window (this is required to call in order to get keyboard/mouse input, etc)
     ///
@@ -372,6 +924,34 @@ impl Window {
         self.0.get_scroll_wheel()
     }
 
+    ///
+    /// Switches the mouse input to a more precise source where it's available (XInput2 on
+    /// X11). Positions get sub-pixel precision, touchpads and high resolution wheels scroll in
+    /// fractions of a step and every motion event since the previous update is kept, see
+    /// `get_pointer_history`. Returns false if it isn't supported, the mouse input is then
+    /// unchanged.
+    ///
+    pub fn set_precise_pointer(&mut self, enable: bool) -> bool {
+        self.0.set_precise_pointer(enable)
+    }
+
+    ///
+    /// Returns all positions of the mouse since the previous update in the order they
+    /// happened. This is only filled in when `set_precise_pointer` is enabled, so motion that
+    /// happens between two frames isn't lost.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// for sample in window.get_pointer_history() {
+    ///     stroke.push((sample.x, sample.y));
+    /// }
+    /// ```
+    ///
+    pub fn get_pointer_history(&self) -> &[PointerSample] {
+        self.0.get_pointer_history()
+    }
+
     ///
     /// Set a different cursor style. This can be used if you have resizing
     /// elements or something like that
@@ -386,6 +966,151 @@ impl Window {
         self.0.set_cursor_style(cursor)
     }
 
+    ///
+    /// Replaces the cursor with a custom image while it's over the window. The image is in ARGB
+    /// format (alpha in the top 8 bits) and `hot_x`, `hot_y` is the point within the image that
+    /// matches the mouse position. The image is scaled together with the window.
+    /// As the cursor is drawn by the OS it can be moved around without updating the buffer which
+    /// is useful for things like crosshairs on top of content that is expensive to render.
+    /// Calling `set_cursor_style` switches back to a regular cursor.
+    ///
+    /// Only supported on X11, other platforms return `Error::NotSupported` and keep the current
+    /// cursor.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let mut crosshair = vec![0u32; 16 * 16];
+    ///
+    /// for i in 0..16 {
+    ///     crosshair[(8 * 16) + i] = 0xffffffff;
+    ///     crosshair[(i * 16) + 8] = 0xffffffff;
+    /// }
+    ///
+    /// window.set_cursor_image(&crosshair, 16, 16, 8, 8).unwrap();
+    /// ```
+    ///
+    pub fn set_cursor_image(&mut self, image: &[u32], width: usize, height: usize,
+                            hot_x: usize, hot_y: usize) -> Result<()> {
+        self.0.set_cursor_image(image, width, height, hot_x, hot_y)
+    }
+
+    ///
+    /// Sets per channel curves that the colors of the buffer are mapped through when presenting.
+    /// Each curve has 256 entries that map the input value of the channel to the output value.
+    /// This can be used for gamma correction, brightness, night mode dimming and similar without
+    /// a separate pass over the buffer. The curves are applied before the lut (set with
+    /// `set_color_lut`).
+    ///
+    /// Only supported on X11, other platforms return `Error::NotSupported` after checking the
+    /// arguments.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// // Dim to 40% and apply a 1.2 gamma
+    /// let curve: Vec<u8> = (0..256).map(|i| {
+    ///     ((i as f32 / 255.0).powf(1.2) * 0.4 * 255.0 + 0.5) as u8
+    /// }).collect();
+    ///
+    /// window.set_color_curves(&curve, &curve, &curve).unwrap();
+    /// ```
+    ///
+    pub fn set_color_curves(&mut self, red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+        self.0.set_color_curves(red, green, blue)
+    }
+
+    ///
+    /// Sets a 3D color lut that is applied (with tetrahedral interpolation) when presenting. The
+    /// lut has `size` x `size` x `size` entries (size is 2 - 65) in the same format as the buffer
+    /// and is indexed with `r + g * size + b * size * size` where r, g and b go from 0 to size - 1.
+    /// Useful for calibrated colors on displays with a measured lut.
+    ///
+    /// Only supported on X11, other platforms return `Error::NotSupported` after checking the
+    /// arguments.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// // Identity lut
+    /// let size = 17;
+    /// let mut lut = vec![0u32; size * size * size];
+    ///
+    /// for b in 0..size {
+    ///     for g in 0..size {
+    ///         for r in 0..size {
+    ///             let c = |v| ((v * 255) / (size - 1)) as u32;
+    ///             lut[r + g * size + b * size * size] = (c(r) << 16) | (c(g) << 8) | c(b);
+    ///         }
+    ///     }
+    /// }
+    ///
+    /// window.set_color_lut(size, &lut).unwrap();
+    /// ```
+    ///
+    pub fn set_color_lut(&mut self, size: usize, lut: &[u32]) -> Result<()> {
+        self.0.set_color_lut(size, lut)
+    }
+
+    ///
+    /// Removes the curves and lut set with `set_color_curves` and `set_color_lut`
+    ///
+    pub fn clear_color_transform(&mut self) {
+        self.0.clear_color_transform()
+    }
+
+    ///
+    /// Sets effects that are applied to the rows of the buffer as they are scaled up. This
+    /// avoids rendering at the scaled size (and the memory that needs) to get CRT like effects.
+    /// The effects need client side scaling with a scale above X1.
+    ///
+    /// Currently only implemented on X11, other platforms present the buffer unchanged.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// window.set_post_effects(PostEffects {
+    ///     scanlines: 96,
+    ///     shadow_mask: 64,
+    ///     ..PostEffects::default()
+    /// });
+    /// ```
+    ///
+    pub fn set_post_effects(&mut self, effects: PostEffects) {
+        self.0.set_post_effects(effects)
+    }
+
+    ///
+    /// Starts (or stops) measuring how long it takes from an input event until the next frame
+    /// presented with one of the update functions has been drawn. The time is taken by the
+    /// display server so it includes the time the event waits to be picked up, the rendering
+    /// and the upload. Tracking costs a round-trip for each frame that follows input.
+    /// Stopping drops the histogram.
+    ///
+    /// Currently only implemented on X11.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// window.set_latency_tracking(true);
+    /// // ... run the application
+    /// if let Some(histogram) = window.latency_histogram() {
+    ///     println!("99% of frames within {:?} ms", histogram.percentile(0.99));
+    /// }
+    /// ```
+    ///
+    pub fn set_latency_tracking(&mut self, enable: bool) {
+        self.0.set_latency_tracking(enable)
+    }
+
+    ///
+    /// Returns the latencies measured since `set_latency_tracking` was enabled or None if it
+    /// isn't enabled (or not supported).
+    ///
+    pub fn latency_histogram(&self) -> Option<LatencyHistogram> {
+        self.0.latency_histogram()
+    }
+
     ///
     /// Get the current keys that are down.
     ///
@@ -474,6 +1199,9 @@ impl Window {
     /// Sets the delay for when a key is being held before it starts being repeated the default
     /// value is 0.25 sec
     ///
+    /// On X11 (and with the rfb feature) keys are repeated by the server (or viewer),
+    /// independent of the frame rate, and this is ignored.
+    ///
     /// # Examples
     ///
     /// ```ignore
@@ -489,6 +1217,9 @@ impl Window {
     /// Sets the rate in between when the keys has passed the initial repeat_delay. The default
     /// value is 0.05 sec
     ///
+    /// On X11 (and with the rfb feature) keys are repeated by the server (or viewer),
+    /// independent of the frame rate, and this is ignored.
+    ///
     /// # Examples
     ///
     /// ```ignore
@@ -564,6 +1295,37 @@ impl Window {
         self.0.get_unix_menus()
     }
 
+    ///
+    /// Processes the input that has arrived without presenting anything or blocking. Together
+    /// with the connection fd (from `as_raw_fd`) this allows driving the window from an
+    /// epoll/mio/tokio based event loop: wait until the fd is readable and call this. Call it
+    /// once before starting to wait as updates may already have read events from the connection.
+    /// Only available on X11.
+    ///
+    /// # Examples
+    ///
+    /// ```ignore
+    /// let fd = window.as_raw_fd();
+    /// reactor.register(fd, READABLE);
+    ///
+    /// loop {
+    ///     window.dispatch_pending();
+    ///     if window.is_key_down(Key::Escape) {
+    ///         break;
+    ///     }
+    ///     reactor.wait();
+    /// }
+    /// ```
+    #[cfg(any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd"))]
+    #[inline]
+    pub fn dispatch_pending(&mut self) {
+        self.0.dispatch_pending()
+    }
+
     ///
     /// Check if a menu item has been pressed
     ///
@@ -819,6 +1581,13 @@ impl Default for WindowOptions {
             title: true,
             resize: false,
             scale: Scale::X1,
+            retain: false,
+            scale_mode: ScaleMode::Client,
+            banded: false,
+            rotation: Rotation::None,
+            flip_x: false,
+            flip_y: false,
+            fullscreen: Fullscreen::None,
         }
     }
 }
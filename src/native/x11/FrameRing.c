@@ -0,0 +1,344 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shared memory ring of frames that allows one process to produce frames that another process presents without
+// copying them through a pipe. It's a triple buffer: the producer owns one frame, the consumer owns one and the third
+// is the latest published frame. Publishing and acquiring is a single atomic exchange of the index of the latest frame
+// so neither side ever waits for the other. A sequence number is bumped on each publish and used as a futex so the
+// consumer can sleep until a new frame arrives.
+
+#define FRAME_RING_MAGIC 0x4d464246
+#define FRAME_RING_VERSION 1
+#define FRAME_COUNT 3
+#define FRAME_NEW 0x4
+
+typedef struct FrameRingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t frame_size;
+    uint32_t state;
+    uint32_t sequence;
+} FrameRingHeader;
+
+// The layout is copied out of the header once it has been validated as the other process can change the header at
+// any time
+typedef struct FrameRing
+{
+    FrameRingHeader* header;
+    size_t size;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t frame_size;
+    int fd;
+    int owned_index;
+    int has_frame;
+    char* name;
+} FrameRing;
+
+// Frames start at a page boundary and rows are padded to a cache line
+#define HEADER_SIZE 4096
+#define ROW_ALIGN 16
+
+// Largest width and height, keeps the size of a frame well within 32 bits
+#define MAX_FRAME_DIM 16384
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static FrameRing* map_ring(int fd, size_t size, const char* name, int create)
+{
+    FrameRing* ring;
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (data == MAP_FAILED) {
+        printf("Unable to map frame ring %s\n", name);
+        return 0;
+    }
+
+    ring = (FrameRing*)calloc(1, sizeof(FrameRing));
+
+    if (!ring) {
+        munmap(data, size);
+        return 0;
+    }
+
+    ring->header = (FrameRingHeader*)data;
+    ring->size = size;
+    ring->fd = fd;
+    ring->has_frame = 0;
+    ring->name = create ? strdup(name) : 0;
+
+    return ring;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* mfb_frame_ring_create(const char* name, int width, int height)
+{
+    FrameRing* ring;
+    FrameRingHeader* header;
+    uint32_t stride;
+    uint32_t frame_size;
+    size_t size;
+    int fd;
+
+    if (width <= 0 || height <= 0 || width > MAX_FRAME_DIM || height > MAX_FRAME_DIM) {
+        printf("Invalid frame ring size %d x %d\n", width, height);
+        return 0;
+    }
+
+    stride = (width + ROW_ALIGN - 1) & ~(ROW_ALIGN - 1);
+    frame_size = ((stride * height * 4) + 4095) & ~4095;
+    size = HEADER_SIZE + ((size_t)frame_size * FRAME_COUNT);
+
+    // Never reuse an existing ring, resizing it would pull the memory away from under a consumer that has it mapped
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd < 0) {
+        printf("Unable to create frame ring %s\n", name);
+        return 0;
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        printf("Unable to allocate %d bytes for frame ring %s\n", (int)size, name);
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    ring = map_ring(fd, size, name, 1);
+
+    if (!ring) {
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    ring->width = width;
+    ring->height = height;
+    ring->stride = stride;
+    ring->frame_size = frame_size;
+
+    header = ring->header;
+    header->width = width;
+    header->height = height;
+    header->stride = stride;
+    header->frame_size = frame_size;
+    header->sequence = 0;
+
+    // The producer starts with frame 0 and frame 1 is the (not yet published) latest one
+    ring->owned_index = 0;
+    header->state = 1;
+    header->version = FRAME_RING_VERSION;
+    __atomic_store_n(&header->magic, FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+
+    return ring;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* mfb_frame_ring_open(const char* name)
+{
+    FrameRing* ring;
+    FrameRingHeader* header;
+    struct stat st;
+    int fd = shm_open(name, O_RDWR, 0);
+
+    if (fd < 0) {
+        printf("Unable to open frame ring %s\n", name);
+        return 0;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        printf("Frame ring %s isn't initialized\n", name);
+        close(fd);
+        return 0;
+    }
+
+    ring = map_ring(fd, st.st_size, name, 0);
+
+    if (!ring) {
+        close(fd);
+        return 0;
+    }
+
+    header = ring->header;
+
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != FRAME_RING_MAGIC ||
+        header->version != FRAME_RING_VERSION) {
+        printf("Frame ring %s has an unsupported layout\n", name);
+        munmap(ring->header, ring->size);
+        close(fd);
+        free(ring);
+        return 0;
+    }
+
+    // Each field is read once and only the checked copy is used from now on
+    ring->width = __atomic_load_n(&header->width, __ATOMIC_RELAXED);
+    ring->height = __atomic_load_n(&header->height, __ATOMIC_RELAXED);
+    ring->stride = __atomic_load_n(&header->stride, __ATOMIC_RELAXED);
+    ring->frame_size = __atomic_load_n(&header->frame_size, __ATOMIC_RELAXED);
+
+    if (ring->width == 0 || ring->height == 0 || ring->width > MAX_FRAME_DIM || ring->height > MAX_FRAME_DIM ||
+        ring->stride < ring->width || ring->stride > MAX_FRAME_DIM ||
+        (uint64_t)ring->stride * ring->height * 4 > ring->frame_size ||
+        HEADER_SIZE + ((uint64_t)ring->frame_size * FRAME_COUNT) > ring->size) {
+        printf("Frame ring %s has an invalid frame layout\n", name);
+        munmap(ring->header, ring->size);
+        close(fd);
+        free(ring);
+        return 0;
+    }
+
+    ring->owned_index = 2;
+
+    return ring;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_frame_ring_info(void* ring_ptr, int* width, int* height, int* stride)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+    *width = ring->width;
+    *height = ring->height;
+    *stride = ring->stride;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t* get_frame(FrameRing* ring, int index)
+{
+    return (uint32_t*)((char*)ring->header + HEADER_SIZE + ((size_t)ring->frame_size * index));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the frame currently owned by the producer
+
+uint32_t* mfb_frame_ring_back_buffer(void* ring_ptr)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+    return get_frame(ring, ring->owned_index);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_frame_ring_publish(void* ring_ptr)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+    FrameRingHeader* header = ring->header;
+    uint32_t prev = __atomic_exchange_n(&header->state, ring->owned_index | FRAME_NEW, __ATOMIC_ACQ_REL);
+
+    // The other side can write anything into the state, an invalid index keeps drawing into the current frame
+    if ((prev & (FRAME_NEW - 1)) < FRAME_COUNT)
+        ring->owned_index = prev & (FRAME_NEW - 1);
+
+    __atomic_add_fetch(&header->sequence, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &header->sequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Takes ownership of the latest published frame (if there is a new one) and returns the frame owned by the consumer
+// or NULL if nothing has been published yet. is_new is set to 1 if the frame wasn't returned by the previous call.
+
+uint32_t* mfb_frame_ring_acquire(void* ring_ptr, int* is_new)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+    FrameRingHeader* header = ring->header;
+
+    *is_new = 0;
+
+    if (__atomic_load_n(&header->state, __ATOMIC_ACQUIRE) & FRAME_NEW) {
+        uint32_t prev = __atomic_exchange_n(&header->state, ring->owned_index, __ATOMIC_ACQ_REL);
+
+        if ((prev & (FRAME_NEW - 1)) < FRAME_COUNT) {
+            ring->owned_index = prev & (FRAME_NEW - 1);
+            ring->has_frame = 1;
+            *is_new = 1;
+        }
+    }
+
+    return ring->has_frame ? get_frame(ring, ring->owned_index) : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sleeps until a frame newer than the last acquired is published or the timeout (in ms, negative waits forever)
+// expires. Returns 1 if there is a new frame.
+
+int mfb_frame_ring_wait(void* ring_ptr, int timeout_ms)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+    FrameRingHeader* header = ring->header;
+    struct timespec deadline, now, timeout;
+
+    // The futex timeout is relative so the time left until the deadline is passed again after each early return
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    for (;;) {
+        uint32_t sequence = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&header->state, __ATOMIC_ACQUIRE) & FRAME_NEW)
+            return 1;
+
+        if (timeout_ms >= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+            timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+
+            if (timeout.tv_nsec < 0) {
+                timeout.tv_sec--;
+                timeout.tv_nsec += 1000000000;
+            }
+
+            if (timeout.tv_sec < 0)
+                return 0;
+        }
+
+        // Returns early if the sequence has already changed or on a signal, in both cases the state is checked again
+        if (syscall(SYS_futex, &header->sequence, FUTEX_WAIT, sequence, timeout_ms < 0 ? NULL : &timeout, NULL, 0) != 0 &&
+            errno == ETIMEDOUT) {
+            return (__atomic_load_n(&header->state, __ATOMIC_ACQUIRE) & FRAME_NEW) != 0;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_frame_ring_close(void* ring_ptr)
+{
+    FrameRing* ring = (FrameRing*)ring_ptr;
+
+    munmap(ring->header, ring->size);
+    close(ring->fd);
+
+    if (ring->name) {
+        shm_unlink(ring->name);
+        free(ring->name);
+    }
+
+    free(ring);
+}
@@ -1,11 +1,22 @@
 #include <X11/Xresource.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/Xatom.h>
 #include <X11/Xcursor/Xcursor.h>
+#include <X11/extensions/Xrender.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xinerama.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -20,6 +31,46 @@ static long keySym2Unicode(unsigned int keysym);
 const uint32_t WINDOW_BORDERLESS = 1 << 1; 
 const uint32_t WINDOW_RESIZE = 1 << 2; 
 const uint32_t WINDOW_TITLE = 1 << 3; 
+const uint32_t WINDOW_RETAIN = 1 << 4;
+const uint32_t WINDOW_SERVER_SCALE = 1 << 5;
+const uint32_t WINDOW_SERVER_SCALE_BILINEAR = 1 << 6;
+const uint32_t WINDOW_BANDED = 1 << 7;
+const uint32_t WINDOW_ROTATE_90 = 1 << 8;
+const uint32_t WINDOW_ROTATE_180 = 2 << 8;
+const uint32_t WINDOW_ROTATE_270 = 3 << 8;
+const uint32_t WINDOW_FLIP_X = 1 << 10;
+const uint32_t WINDOW_FLIP_Y = 1 << 11;
+const uint32_t WINDOW_FULLSCREEN = 1 << 12;
+const uint32_t WINDOW_EXCLUSIVE = 1 << 13;
+
+// Parts of the _MOTIF_WM_HINTS property that are used
+#define MWM_HINTS_DECORATIONS (1 << 1)
+#define MWM_DECOR_BORDER (1 << 1)
+#define MWM_DECOR_RESIZEH (1 << 2)
+
+// Size of the draw buffer in banded mode
+#define BAND_SIZE (256 * 1024)
+
+// Bytes of tiles that are uploaded before the requests are flushed to the server
+#define TILE_FLUSH_SIZE (256 * 1024)
+
+// Number of rows gathered at a time when the buffer is rotated or flipped
+#define ORIENT_BLOCK 16
+
+// The shadow mask repeats every 3 columns, EFFECT_PERIOD is the smallest multiple of it that is whole SSE registers
+#define EFFECT_PERIOD 12
+#define EFFECT_COLUMNS 16
+
+// Latencies are counted in 1 ms buckets, the last one also counts everything longer
+#define LATENCY_BUCKETS 128
+
+// Number of pointer samples kept between two updates, enough for a 1000 Hz mouse at 4 fps
+#define POINTER_HISTORY 256
+
+#define MAX_SCROLL_AXES 16
+
+#define WINDOW_EVENT_MASK (StructureNotifyMask | ExposureMask | PointerMotionMask | LeaveWindowMask | \
+                           ButtonPressMask | KeyPressMask | KeyReleaseMask | ButtonReleaseMask | FocusChangeMask)
 
 void mfb_close(void* window_info);
 
@@ -34,9 +85,44 @@ static int s_setup_done = 0;
 static Visual* s_visual;
 static int s_screen_width;
 static int s_screen_height;
-static int s_keyb_ext = 0;
+static int s_keyb_ext = -1;
+static int s_detectable_repeat = 0;
+static int s_render_ext = -1;
+static int s_xi_opcode = -1;
+static int s_raw_motion = 0;
 static XContext s_context;
 static Atom s_wm_delete_window;
+static Atom s_net_wm_state;
+static Atom s_net_wm_state_fullscreen;
+static Atom s_net_wm_bypass_compositor;
+static Atom s_motif_wm_hints;
+static Atom s_latency_atom;
+static Colormap s_colormap;
+
+// Phases of an update reported to the trace. Needs to match TRACE_PHASES in os/unix/mod.rs
+enum TracePhase {
+    TracePhase_Prepare,
+    TracePhase_Put,
+    TracePhase_Flush,
+    TracePhase_Latency,
+    TracePhase_Events,
+    TracePhase_Pointer,
+};
+
+// Set while a trace is recorded, receives the phases of each update with begin and end in nanoseconds
+static void (*s_trace)(void* window, int phase, uint64_t begin, uint64_t end) = 0;
+
+// Formats that the 0RGB input can be converted to. Ordered from most to least preferred
+enum PixelFormat {
+    PixelFormat_RGB32,
+    PixelFormat_RGB24,
+    PixelFormat_RGB565,
+    PixelFormat_RGB555,
+    PixelFormat_Unsupported,
+};
+
+static int s_pixel_format;
+static int s_bytes_per_pixel;
 
 // Needs to match lib.rs enum
 enum CursorStyle {
@@ -66,6 +152,38 @@ typedef struct SharedData {
     uint8_t state[3];
 } SharedData;
 
+// Needs to match lib.rs struct
+typedef struct PointerSample {
+    float x;
+    float y;
+    float raw_x;
+    float raw_y;
+    uint32_t time;
+} PointerSample;
+
+// Planes of a 4:2:0 frame given to mfb_update_with_yuv. For NV12 planes[1] holds the interleaved U and V samples.
+// coeffs are the conversion factors computed in buffer_helper.rs: Y offset and then Y, V to R, U to G, V to G and
+// U to B in 2.13 fixed point.
+typedef struct YuvFrame {
+    const uint8_t* planes[3];
+    int strides[3];
+    int nv12;
+    int16_t coeffs[6];
+} YuvFrame;
+
+// Smooth scrolling is reported as changes of the scroll valuators of the pointer devices
+typedef struct ScrollAxis {
+    int device;
+    int number;
+    int horizontal;
+    double increment;
+    double value;
+    int has_value;
+} ScrollAxis;
+
+static ScrollAxis s_scroll_axes[MAX_SCROLL_AXES];
+static int s_scroll_axis_count = 0;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 typedef struct WindowInfo {
@@ -74,40 +192,201 @@ typedef struct WindowInfo {
     void* rust_data;
     SharedData* shared_data;
     Window window;
+    Window frame;
+    int exclusive;
     XImage* ximage;
     void* draw_buffer;
+    void* line_buffer;
+    int draw_scale;
+    int band_rows;
+    int tile_bytes;
+    Pixmap pixmap;
+    Picture src_picture;
+    Picture window_picture;
+    uint32_t* prev_buffer;
+    void* pending_buffer;
+    XImage* pending_image;
+    int pending_stride;
+    int pending_y0;
+    int pending_y1;
+    int buffer_width;
+    int buffer_height;
+    int input_width;
+    int input_height;
+    int orientation;
+    int map_x[3];
+    int map_y[3];
+    uint32_t* orient_buffer;
+    const YuvFrame* yuv;
+    int index_pass;
+    uint32_t* input_row;
+    uint32_t* input_buffer;
+    uint8_t* indices;
+    uint32_t palette[256];
+    int palette_changed;
+    int indexed_frame;
+    int has_frame;
+    // Window whose image holds the frame shown by mfb_update_mirrored or 0
+    Window shared_frame;
     int scale;
     int width;
     int height;
     int update;
     int prev_cursor;
+    Cursor image_cursor;
+    uint8_t* color_curves;
+    uint32_t* color_lut;
+    int color_lut_size;
+    uint32_t* color_buffer;
+    uint32_t* effect_buffer;
+    uint16_t effect_factors[2][EFFECT_COLUMNS][4];
+    int effect_scanlines;
+    int effect_mask;
+    int effect_edge_blend;
+    uint32_t* latency_histogram;
+    Time latency_input;
+    PointerSample* pointer_history;
+    int pointer_count;
+    float raw_x;
+    float raw_y;
+    Time raw_time;
+    uint8_t keys_down[32];
 } WindowInfo;
 
+// Window that has the pointer, raw motion isn't sent to a window so it goes to this one
+static WindowInfo* s_pointer_info = 0;
+
+static void put_banded(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int y0, int x1, int y1, 
+                       Drawable target);
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static void init_cursors() {
-    s_cursors[CursorStyle_Arrow] = XcursorLibraryLoadCursor(s_display, "arrow"); 
-    s_cursors[CursorStyle_Ibeam] = XcursorLibraryLoadCursor(s_display, "xterm"); 
-    s_cursors[CursorStyle_Crosshair] = XcursorLibraryLoadCursor(s_display, "crosshair"); 
-    s_cursors[CursorStyle_ClosedHand] = XcursorLibraryLoadCursor(s_display, "hand2"); 
-    s_cursors[CursorStyle_OpenHand] = XcursorLibraryLoadCursor(s_display, "hand2"); 
-    s_cursors[CursorStyle_ResizeLeftRight] = XcursorLibraryLoadCursor(s_display, "sb_h_double_arrow"); 
-    s_cursors[CursorStyle_ResizeUpDown] = XcursorLibraryLoadCursor(s_display, "sb_v_double_arrow"); 
-    s_cursors[CursorStyle_SizeAll] = XcursorLibraryLoadCursor(s_display, "diamond_cross"); 
+static int native_byte_order() {
+    const uint16_t t = 1;
+    return *(const uint8_t*)&t ? LSBFirst : MSBFirst;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static int setup_display() {
-    int major = 1;
-    int minor = 0;
-	int majorOpcode = 0;
-	int eventBase = 0;
-	int errorBase = 0;
+static int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loading a cursor looks it up in the cursor theme on disk so they are only loaded when first used
+
+static Cursor get_cursor(int style) {
+    static const char* names[CursorStyle_Count] = {
+        "arrow",
+        "xterm",
+        "crosshair",
+        "hand2",
+        "hand2",
+        "sb_h_double_arrow",
+        "sb_v_double_arrow",
+        "diamond_cross",
+    };
+
+    if (!s_cursors[style])
+        s_cursors[style] = XcursorLibraryLoadCursor(s_display, names[style]);
+
+    return s_cursors[style];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int get_bits_per_pixel(int depth) {
+    int i, count, bits_per_pixel = -1;
+    XPixmapFormatValues* formats = XListPixmapFormats(s_display, &count);
 
-    int depth, i, formatCount, convDepth = -1;
-    XPixmapFormatValues* formats;
+    for (i = 0; i < count; ++i) {
+        if (depth == formats[i].depth) {
+            bits_per_pixel = formats[i].bits_per_pixel;
+            break;
+        }
+    }
+
+    XFree(formats);
+
+    return bits_per_pixel;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int get_pixel_format(const XVisualInfo* info) {
+    int rgb888 = info->red_mask == 0xff0000 && info->green_mask == 0xff00 && info->blue_mask == 0xff;
+
+    if (info->class != TrueColor)
+        return PixelFormat_Unsupported;
+
+    switch (get_bits_per_pixel(info->depth)) {
+        case 32: 
+            return rgb888 ? PixelFormat_RGB32 : PixelFormat_Unsupported;
+        case 24: 
+            return rgb888 ? PixelFormat_RGB24 : PixelFormat_Unsupported;
+        case 16: {
+            if (info->red_mask == 0xf800 && info->green_mask == 0x07e0 && info->blue_mask == 0x1f)
+                return PixelFormat_RGB565;
+            if (info->red_mask == 0x7c00 && info->green_mask == 0x03e0 && info->blue_mask == 0x1f)
+                return PixelFormat_RGB555;
+        }
+    }
+
+    return PixelFormat_Unsupported;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Uses the default visual if we can convert to it, otherwise the best TrueColor visual on the screen
+
+static int find_visual() {
+    XVisualInfo template;
+    XVisualInfo* infos;
+    int i, count, format;
+    int best = -1, best_format = PixelFormat_Unsupported;
+
+    template.visualid = XVisualIDFromVisual(DefaultVisual(s_display, s_screen));
+    infos = XGetVisualInfo(s_display, VisualIDMask, &template, &count);
+
+    if (infos && count > 0 && (format = get_pixel_format(&infos[0])) != PixelFormat_Unsupported) {
+        s_visual = infos[0].visual;
+        s_depth = infos[0].depth;
+        s_pixel_format = format;
+        XFree(infos);
+        return 1;
+    }
+
+    if (infos)
+        XFree(infos);
+
+    template.screen = s_screen;
+    template.class = TrueColor;
+    infos = XGetVisualInfo(s_display, VisualScreenMask | VisualClassMask, &template, &count);
+
+    for (i = 0; i < count; ++i) {
+        format = get_pixel_format(&infos[i]);
+
+        if (format < best_format) {
+            best_format = format;
+            best = i;
+        }
+    }
+
+    if (best != -1) {
+        s_visual = infos[best].visual;
+        s_depth = infos[best].depth;
+        s_pixel_format = best_format;
+    }
+
+    if (infos)
+        XFree(infos);
+
+    return best != -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static int setup_display() {
     if (s_setup_done) {
         return 1;
     }
@@ -121,43 +400,199 @@ static int setup_display() {
 
     s_context = XUniqueContext();
     s_screen = DefaultScreen(s_display);
-    s_visual = DefaultVisual(s_display, s_screen);
-    formats = XListPixmapFormats(s_display, &formatCount);
-    depth = DefaultDepth(s_display, s_screen);
-
-    for (i = 0; i < formatCount; ++i) {
-        if (depth == formats[i].depth) {
-            convDepth = formats[i].bits_per_pixel;
-            break;
-        }
-    }
-  
-    XFree(formats);
 
-    // We only support 32-bit right now
-    if (convDepth != 32) {
-        printf("Unable to find 32-bit format for X11 display\n");
+    if (!find_visual()) {
+        printf("Unable to find a 32, 24 or 16-bit TrueColor visual for X11 display\n");
         XCloseDisplay(s_display);
         return 0;
     }
 
-    s_depth = depth;
+    switch (s_pixel_format) {
+        case PixelFormat_RGB32: s_bytes_per_pixel = 4; break;
+        case PixelFormat_RGB24: s_bytes_per_pixel = 3; break;
+        default: s_bytes_per_pixel = 2; break;
+    }
 
-    s_gc = DefaultGC(s_display, s_screen);
+    // The default GC and colormap can only be used with the default visual. Otherwise the GC 
+    // is created together with the first window
+    if (s_visual == DefaultVisual(s_display, s_screen)) {
+        s_gc = DefaultGC(s_display, s_screen);
+        s_colormap = DefaultColormap(s_display, s_screen);
+    } else {
+        s_gc = 0;
+        s_colormap = XCreateColormap(s_display, DefaultRootWindow(s_display), s_visual, AllocNone);
+    }
 
     s_screen_width = DisplayWidth(s_display, s_screen);
     s_screen_height = DisplayHeight(s_display, s_screen);
 
-    const char* wmDeleteWindowName = "WM_DELETE_WINDOW";
-    XInternAtoms(s_display, (char**)&wmDeleteWindowName, 1, False, &s_wm_delete_window);
+    // This is the only round-trip during setup. The visuals and pixmap formats are part of the connection setup
+    // and Xkb is queried on the first key event.
+    const char* atom_names[] = {
+        "WM_DELETE_WINDOW",
+        "_NET_WM_STATE",
+        "_NET_WM_STATE_FULLSCREEN",
+        "_NET_WM_BYPASS_COMPOSITOR",
+        "_MOTIF_WM_HINTS",
+    };
+    Atom atoms[5];
+
+    XInternAtoms(s_display, (char**)atom_names, 5, False, atoms);
+    s_wm_delete_window = atoms[0];
+    s_net_wm_state = atoms[1];
+    s_net_wm_state_fullscreen = atoms[2];
+    s_net_wm_bypass_compositor = atoms[3];
+    s_motif_wm_hints = atoms[4];
 
     s_setup_done = 1;
 
-    init_cursors();
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	s_keyb_ext = XkbQueryExtension(s_display, &majorOpcode, &eventBase, &errorBase, &major, &minor);
+static int has_keyboard_ext() {
+    int major = 1;
+    int minor = 0;
+    int majorOpcode = 0;
+    int eventBase = 0;
+    int errorBase = 0;
 
-    return 1;
+    // Held keys are repeated as key presses without releases in between so the repeats can be told from new presses
+    if (s_keyb_ext == -1) {
+        s_keyb_ext = XkbQueryExtension(s_display, &majorOpcode, &eventBase, &errorBase, &major, &minor);
+
+        if (s_keyb_ext)
+            XkbSetDetectableAutoRepeat(s_display, True, &s_detectable_repeat);
+    }
+
+    return s_keyb_ext;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// XInput 2.1 is needed for smooth scrolling. Only queried when first used as it's a round-trip
+
+static int has_xinput2() {
+    int event_base, error_base;
+    int major = 2;
+    int minor = 1;
+
+    if (s_xi_opcode == -1) {
+        if (!XQueryExtension(s_display, "XInputExtension", &s_xi_opcode, &event_base, &error_base) ||
+            XIQueryVersion(s_display, &major, &minor) != Success || (major == 2 && minor < 1))
+            s_xi_opcode = 0;
+    }
+
+    return s_xi_opcode != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int setup_render() {
+    int event_base, error_base;
+
+    if (s_render_ext == -1)
+        s_render_ext = XRenderQueryExtension(s_display, &event_base, &error_base) ? 1 : 0;
+
+    return s_render_ext;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Area of the monitor the pointer is on, fullscreen windows are opened there and sized for it. With a single monitor
+// (or without Xinerama) it's the whole screen.
+
+static void get_monitor_rect(int* x, int* y, int* width, int* height) {
+    XineramaScreenInfo* screens;
+    Window root, child;
+    int pointer_x = 0, pointer_y = 0, child_x, child_y;
+    int count = 0, i;
+    unsigned int mask;
+
+    *x = 0;
+    *y = 0;
+    *width = s_screen_width;
+    *height = s_screen_height;
+
+    if (!XineramaIsActive(s_display))
+        return;
+
+    screens = XineramaQueryScreens(s_display, &count);
+
+    if (!screens)
+        return;
+
+    XQueryPointer(s_display, DefaultRootWindow(s_display), &root, &child, &pointer_x, &pointer_y,
+                  &child_x, &child_y, &mask);
+
+    for (i = 0; i < count; ++i) {
+        const XineramaScreenInfo* s = &screens[i];
+
+        // The first monitor is used if the pointer isn't on any of them
+        if (i == 0 || (pointer_x >= s->x_org && pointer_x < s->x_org + s->width &&
+                       pointer_y >= s->y_org && pointer_y < s->y_org + s->height)) {
+            *x = s->x_org;
+            *y = s->y_org;
+            *width = s->width;
+            *height = s->height;
+        }
+    }
+
+    XFree(screens);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// With server side scaling the buffer is uploaded unscaled into a Pixmap and XRender scales it into the window.
+// The transform maps window coordinates back to the Pixmap so the projective part is simply the scale.
+
+static void create_server_scaler(WindowInfo* info, unsigned int flags) {
+    XRenderPictFormat* format = XRenderFindVisualFormat(s_display, s_visual);
+    XRenderPictureAttributes attributes;
+    XTransform transform = {{
+        { XDoubleToFixed(1), 0, 0 },
+        { 0, XDoubleToFixed(1), 0 },
+        { 0, 0, XDoubleToFixed(info->scale) },
+    }};
+
+    info->pixmap = XCreatePixmap(s_display, info->window, info->buffer_width, info->buffer_height, s_depth);
+    XFillRectangle(s_display, info->pixmap, s_gc, 0, 0, info->buffer_width, info->buffer_height);
+
+    // Pad the edges so bilinear filtering doesn't blend in transparent black at the borders
+    attributes.repeat = RepeatPad;
+    info->src_picture = XRenderCreatePicture(s_display, info->pixmap, format, CPRepeat, &attributes);
+    info->window_picture = XRenderCreatePicture(s_display, info->window, format, 0, 0);
+
+    XRenderSetPictureTransform(s_display, info->src_picture, &transform);
+    XRenderSetPictureFilter(s_display, info->src_picture, 
+                            (flags & WINDOW_SERVER_SCALE_BILINEAR) ? FilterBilinear : FilterNearest, 0, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets up the mapping from a pixel in the window oriented image (before scaling) to the input buffer. The flips are
+// applied after the rotation so they are undone first:
+// input_x = map_x[0] * x + map_x[1] * y + map_x[2] and the same for input_y with map_y
+
+static void setup_orientation(WindowInfo* info, unsigned int flags) {
+    static const int rotations[4][6] = {
+        { 1, 0, 0, 0, 1, 0 },
+        { 0, 1, 0, -1, 0, 1 },
+        { -1, 0, 1, 0, -1, 1 },
+        { 0, -1, 1, 1, 0, 0 },
+    };
+    const int* r = rotations[(flags & WINDOW_ROTATE_270) >> 8];
+    int fx = (flags & WINDOW_FLIP_X) ? -1 : 1;
+    int fy = (flags & WINDOW_FLIP_Y) ? -1 : 1;
+    int cx = (flags & WINDOW_FLIP_X) ? info->buffer_width - 1 : 0;
+    int cy = (flags & WINDOW_FLIP_Y) ? info->buffer_height - 1 : 0;
+
+    info->orientation = flags & (WINDOW_ROTATE_270 | WINDOW_FLIP_X | WINDOW_FLIP_Y);
+    info->map_x[0] = r[0] * fx;
+    info->map_x[1] = r[1] * fy;
+    info->map_x[2] = (r[0] * cx) + (r[1] * cy) + (r[2] * (info->input_width - 1));
+    info->map_y[0] = r[3] * fx;
+    info->map_y[1] = r[4] * fy;
+    info->map_y[2] = (r[3] * cx) + (r[4] * cy) + (r[5] * (info->input_height - 1));
+
+    info->orient_buffer = info->orientation ? (uint32_t*)malloc(ORIENT_BLOCK * info->buffer_width * 4) : 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -168,42 +603,109 @@ void* mfb_open(const char* title, int width, int height, unsigned int flags, int
     XSizeHints sizeHints;
     XImage* image;
     Window window;
+    Window frame;
     WindowInfo* window_info;
+    int server_scale = 0;
+    int draw_scale;
+    int band_rows = 0;
 
 
     if (!setup_display()) {
         return 0;
     }
 
-    //TODO: Handle no title/borderless 
-    (void)flags;
+    if ((flags & (WINDOW_SERVER_SCALE | WINDOW_SERVER_SCALE_BILINEAR)) && scale > 1) {
+        server_scale = setup_render();
+
+        if (!server_scale)
+            printf("XRender isn't available, using client side scaling\n");
+    }
 
     width *= scale;
     height *= scale;
 
+    // The window shows the buffer turned on its side so the size is swapped
+    if (flags & WINDOW_ROTATE_90) {
+        int t = width;
+        width = height;
+        height = t;
+    }
+
     Window defaultRootWindow = DefaultRootWindow(s_display);
 
     windowAttributes.border_pixel = BlackPixel(s_display, s_screen);
     windowAttributes.background_pixel = BlackPixel(s_display, s_screen);
     windowAttributes.backing_store = NotUseful;
+    windowAttributes.colormap = s_colormap;
+    windowAttributes.override_redirect = (flags & WINDOW_EXCLUSIVE) ? True : False;
+
+    // A fullscreen window covers the screen and the buffer is shown centered in a child window of the scaled size so
+    // the rest of the screen is the black background of the parent. Exclusive fullscreen isn't managed by the window
+    // manager at all.
+    if (flags & (WINDOW_FULLSCREEN | WINDOW_EXCLUSIVE)) {
+        int monitor_x, monitor_y, monitor_width, monitor_height;
+
+        get_monitor_rect(&monitor_x, &monitor_y, &monitor_width, &monitor_height);
+
+        frame = XCreateWindow(s_display, defaultRootWindow, monitor_x, monitor_y, monitor_width, monitor_height, 0,
+                              s_depth, InputOutput, s_visual,
+                              CWBackPixel | CWBorderPixel | CWBackingStore | CWColormap | CWOverrideRedirect,
+                              &windowAttributes);
+
+        window = frame ? XCreateWindow(s_display, frame, (monitor_width - width) / 2,
+                                       (monitor_height - height) / 2, width, height, 0, s_depth, InputOutput,
+                                       s_visual, CWBackPixel | CWBorderPixel | CWBackingStore | CWColormap,
+                                       &windowAttributes) : 0;
+    } else {
+        window = XCreateWindow(s_display, defaultRootWindow, (s_screen_width - width) / 2,
+                        (s_screen_height - height) / 2, width, height, 0, s_depth, InputOutput,
+                        s_visual, CWBackPixel | CWBorderPixel | CWBackingStore | CWColormap,
+                        &windowAttributes);
+        frame = window;
+    }
 
-    window = XCreateWindow(s_display, defaultRootWindow, (s_screen_width - width) / 2,
-                    (s_screen_height - height) / 2, width, height, 0, s_depth, InputOutput,
-                    s_visual, CWBackPixel | CWBorderPixel | CWBackingStore,
-                    &windowAttributes);
     if (!window) {
+        if (frame)
+            XDestroyWindow(s_display, frame);
         printf("Unable to create X11 Window\n");
         return 0;
     }
 
+    if (!s_gc)
+        s_gc = XCreateGC(s_display, window, 0, NULL);
+
     //XSelectInput(s_display, s_window, KeyPressMask | KeyReleaseMask);
-    XStoreName(s_display, window, title);
+    XStoreName(s_display, frame, title);
+
+    XSelectInput(s_display, window, WINDOW_EVENT_MASK);
+
+    if (frame != window) {
+        // Compositors are asked to let the window go straight to the screen
+        long bypass = 1;
 
-    XSelectInput(s_display, window, 
-        StructureNotifyMask |
-        ButtonPressMask | KeyPressMask | KeyReleaseMask | ButtonReleaseMask);
+        XSelectInput(s_display, frame, StructureNotifyMask | KeyPressMask | KeyReleaseMask | FocusChangeMask);
+        XChangeProperty(s_display, frame, s_net_wm_bypass_compositor, XA_CARDINAL, 32, PropModeReplace,
+                        (unsigned char*)&bypass, 1);
 
-    if (!(flags & WINDOW_RESIZE)) {
+        if (!(flags & WINDOW_EXCLUSIVE)) {
+            XChangeProperty(s_display, frame, s_net_wm_state, XA_ATOM, 32, PropModeReplace,
+                            (unsigned char*)&s_net_wm_state_fullscreen, 1);
+        }
+
+        XMapWindow(s_display, window);
+    } else if ((flags & WINDOW_BORDERLESS) || !(flags & WINDOW_TITLE)) {
+        // Motif hints with only the decorations set: none when borderless, otherwise the border (and resize handles)
+        // without the title bar
+        long hints[5] = { MWM_HINTS_DECORATIONS, 0, 0, 0, 0 };
+
+        if (!(flags & WINDOW_BORDERLESS))
+            hints[2] = MWM_DECOR_BORDER | ((flags & WINDOW_RESIZE) ? MWM_DECOR_RESIZEH : 0);
+
+        XChangeProperty(s_display, frame, s_motif_wm_hints, s_motif_wm_hints, 32, PropModeReplace,
+                        (unsigned char*)hints, 5);
+    }
+
+    if (!(flags & WINDOW_RESIZE) && frame == window) {
         sizeHints.flags = PPosition | PMinSize | PMaxSize;
         sizeHints.x = 0;
         sizeHints.y = 0;
@@ -214,36 +716,115 @@ void* mfb_open(const char* title, int width, int height, unsigned int flags, int
         XSetWMNormalHints(s_display, window, &sizeHints);
     }
 
-    XClearWindow(s_display, window);
-    XMapRaised(s_display, window);
-    XFlush(s_display);
+    draw_scale = server_scale ? 1 : scale;
+
+    // In banded mode the draw buffer only holds a few scaled rows that are uploaded one band at a time so the
+    // memory used doesn't grow with the scale
+    if ((flags & WINDOW_BANDED) && !server_scale) {
+        band_rows = BAND_SIZE / (width * s_bytes_per_pixel * draw_scale);
+        band_rows = band_rows < 1 ? 1 : min_int(band_rows, height / scale);
+    }
 
-    image = XCreateImage(s_display, CopyFromParent, s_depth, ZPixmap, 0, NULL, width, height, 32, width * 4);
+    image = XCreateImage(s_display, s_visual, s_depth, ZPixmap, 0, NULL, 
+                         (width / scale) * draw_scale, (band_rows ? band_rows : height / scale) * draw_scale, 32, 0);
 
     if (!image) {
-        XDestroyWindow(s_display, window);
+        XDestroyWindow(s_display, frame);
         printf("Unable to create XImage\n");
         return 0;
     }
 
+    // The rows are written in native byte order (24-bit is always written as LSBFirst) and Xlib swaps if the server
+    // differs
+    image->byte_order = s_pixel_format == PixelFormat_RGB24 ? LSBFirst : native_byte_order();
+
     window_info = (WindowInfo*)malloc(sizeof(WindowInfo));
     window_info->key_callback = 0;
     window_info->char_callback = 0;
     window_info->rust_data = 0;
     window_info->window = window;
+    window_info->frame = frame;
+    window_info->exclusive = (flags & WINDOW_EXCLUSIVE) != 0;
     window_info->ximage = image;
     window_info->scale = scale;
     window_info->width = width;
     window_info->height = height;
-    window_info->draw_buffer = malloc(width * height * 4);
+    window_info->buffer_width = width / scale;
+    window_info->buffer_height = height / scale;
+    window_info->input_width = (flags & WINDOW_ROTATE_90) ? window_info->buffer_height : window_info->buffer_width;
+    window_info->input_height = (flags & WINDOW_ROTATE_90) ? window_info->buffer_width : window_info->buffer_height;
+    window_info->has_frame = 0;
+    window_info->shared_frame = 0;
+    window_info->draw_scale = draw_scale;
+    window_info->band_rows = band_rows;
+    window_info->tile_bytes = 0;
+    window_info->line_buffer = malloc(window_info->buffer_width * 4);
+
+    setup_orientation(window_info, flags);
+
+    window_info->yuv = 0;
+    window_info->index_pass = 0;
+    window_info->input_row = 0;
+    window_info->input_buffer = 0;
+    window_info->indices = 0;
+    window_info->palette_changed = 0;
+    window_info->indexed_frame = 0;
+    memset(window_info->palette, 0, sizeof(window_info->palette));
+
+    // Server side scaling of 32-bit data uploads directly from the input buffer so no draw buffer is needed
+    if (server_scale && s_pixel_format == PixelFormat_RGB32 && !window_info->orientation)
+        window_info->draw_buffer = 0;
+    else
+        window_info->draw_buffer = malloc(image->bytes_per_line * image->height);
+    window_info->pixmap = 0;
+    window_info->src_picture = 0;
+    window_info->window_picture = 0;
+    window_info->prev_buffer = 0;
+    window_info->pending_buffer = 0;
+    window_info->pending_image = 0;
     window_info->update = 1;
-
-    XSetWMProtocols(s_display, window, &s_wm_delete_window, 1);
+    window_info->prev_cursor = CursorStyle_Arrow;
+    window_info->image_cursor = 0;
+    window_info->color_curves = 0;
+    window_info->color_lut = 0;
+    window_info->color_lut_size = 0;
+    window_info->color_buffer = 0;
+    window_info->effect_buffer = 0;
+    window_info->latency_histogram = 0;
+    window_info->latency_input = 0;
+    window_info->pointer_history = 0;
+    window_info->pointer_count = 0;
+    window_info->raw_x = 0.0f;
+    window_info->raw_y = 0.0f;
+    memset(window_info->keys_down, 0, sizeof(window_info->keys_down));
+
+    XSetWMProtocols(s_display, frame, &s_wm_delete_window, 1);
 
     XSaveContext(s_display, window, s_context, (XPointer) window_info);
 
+    if (frame != window)
+        XSaveContext(s_display, frame, s_context, (XPointer) window_info);
+
     image->data = (char*)window_info->draw_buffer;
 
+    // Keep the last frame on the server side. Expose events and partial updates are then
+    // resolved with XCopyArea and only rows that changed since the previous frame are uploaded.
+    if (server_scale) {
+        create_server_scaler(window_info, flags);
+    } else if (flags & WINDOW_RETAIN) {
+        window_info->pixmap = XCreatePixmap(s_display, window, width, height, s_depth);
+        XSetGraphicsExposures(s_display, s_gc, False);
+        XFillRectangle(s_display, window_info->pixmap, s_gc, 0, 0, width, height);
+    }
+
+    // Banded mode repaints from the source sized copy of the last frame as there is no full size image
+    if ((flags & WINDOW_RETAIN) || band_rows)
+        window_info->prev_buffer = (uint32_t*)malloc(window_info->input_width * window_info->input_height * 4);
+
+    // Mapped once everything is set up. The background is cleared by the server and the flush is left to the first
+    // update so the requests are sent together with the first frame.
+    XMapRaised(s_display, frame);
+
     s_window_count += 1;
 
     return (void*)window_info;
@@ -254,7 +835,7 @@ void* mfb_open(const char* title, int width, int height, unsigned int flags, int
 void mfb_set_title(void* window_info, const char* title)
 {
     WindowInfo* info = (WindowInfo*)window_info;
-    XStoreName(s_display, info->window, title);
+    XStoreName(s_display, info->frame, title);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -284,9 +865,72 @@ void mfb_set_cursor_style(void* window_info, int cursor)
 		return;
 	}
 
-    XDefineCursor(s_display, info->window, s_cursors[cursor]);
+    XDefineCursor(s_display, info->frame, get_cursor(cursor));
 
 	info->prev_cursor = cursor;
+
+    if (info->image_cursor) {
+        XFreeCursor(s_display, info->image_cursor);
+        info->image_cursor = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Builds an ARGB cursor from the (unscaled) image and lets the X server draw it on top of the window. Moving it
+// around is then handled fully by the server so the frame buffer doesn't need to be re-uploaded.
+
+int mfb_set_cursor_image(void* window_info, const uint32_t* image, int width, int height, int hot_x, int hot_y)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    XcursorImage* cursor_image;
+    Cursor cursor;
+    int scale = info->scale;
+    int x, y;
+
+    cursor_image = XcursorImageCreate(width * scale, height * scale);
+
+    if (!cursor_image) {
+        printf("Unable to create cursor image\n");
+        return 0;
+    }
+
+    cursor_image->xhot = hot_x * scale;
+    cursor_image->yhot = hot_y * scale;
+
+    for (y = 0; y < height * scale; ++y) {
+        const uint32_t* src = image + (y / scale) * width;
+        XcursorPixel* dest = cursor_image->pixels + y * width * scale;
+
+        for (x = 0; x < width * scale; ++x) {
+            // Xcursor wants premultiplied alpha
+            uint32_t p = src[x / scale];
+            uint32_t a = p >> 24;
+            uint32_t r = (((p >> 16) & 0xff) * a) / 255;
+            uint32_t g = (((p >> 8) & 0xff) * a) / 255;
+            uint32_t b = ((p & 0xff) * a) / 255;
+            dest[x] = (a << 24) | (r << 16) | (g << 8) | b;
+        }
+    }
+
+    cursor = XcursorImageLoadCursor(s_display, cursor_image);
+    XcursorImageDestroy(cursor_image);
+
+    if (!cursor) {
+        printf("Unable to create cursor from image\n");
+        return 0;
+    }
+
+    XDefineCursor(s_display, info->frame, cursor);
+
+    if (info->image_cursor)
+        XFreeCursor(s_display, info->image_cursor);
+
+    info->image_cursor = cursor;
+
+    // make sure set_cursor_style will switch back to a regular cursor
+    info->prev_cursor = -1;
+
+    return 1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -294,7 +938,7 @@ void mfb_set_cursor_style(void* window_info, int cursor)
 static int handle_special_keys(WindowInfo* info, XEvent* event, int down) {
 	int keySym;
 
-	if (!s_keyb_ext) 
+	if (!has_keyboard_ext()) 
 		return 0;
 
 	keySym = XkbKeycodeToKeysym(s_display, event->xkey.keycode, 0, 1);
@@ -327,420 +971,2342 @@ static int handle_special_keys(WindowInfo* info, XEvent* event, int down) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Windows that build their images the same way can upload the image of the other one
 
-static int process_event(XEvent* event) {
-    KeySym sym;
-
-    WindowInfo* info = find_handle(event->xany.window);
+static int same_image(const WindowInfo* a, const WindowInfo* b)
+{
+    return a->draw_buffer && b->draw_buffer && !a->band_rows && !b->band_rows &&
+           a->buffer_width == b->buffer_width && a->buffer_height == b->buffer_height &&
+           a->draw_scale == b->draw_scale && a->orientation == b->orientation &&
+           a->ximage->bytes_per_line == b->ximage->bytes_per_line &&
+           !a->color_curves && !a->color_lut && !a->effect_buffer &&
+           !b->color_curves && !b->color_lut && !b->effect_buffer;
+}
 
-    if (!info)
-        return 1;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-    if (event->type == ClientMessage) {
-        if ((Atom)event->xclient.data.l[0] == s_wm_delete_window) {
-            info->update = 0;
-            mfb_close(info);
+static void repaint(WindowInfo* info, int x, int y, int width, int height) {
+    if (info->src_picture) {
+        XRenderComposite(s_display, PictOpSrc, info->src_picture, None, info->window_picture,
+                         x, y, 0, 0, x, y, width, height);
+    } else if (info->pixmap) {
+        XCopyArea(s_display, info->pixmap, info->window, s_gc, x, y, width, height, x, y);
+    } else if (info->band_rows && info->has_frame) {
+        int scale = info->draw_scale;
+        int x1 = min_int((x + width + scale - 1) / scale, info->buffer_width);
+        int y1 = min_int((y + height + scale - 1) / scale, info->buffer_height);
+
+        if (x / scale < x1 && y / scale < y1)
+            put_banded(info, info->prev_buffer, info->input_width, x / scale, y / scale, x1, y1, info->window);
+    } else if (info->has_frame) {
+        XImage* image = info->ximage;
+        int image_width = image->width;
+        int image_height = image->height;
+
+        // A frame shown from the image of another window is repainted from that image as long as the window is open
+        // and builds its image the same way, otherwise the next update redraws everything
+        if (info->shared_frame) {
+            WindowInfo* owner = 0;
+
+            if (XFindContext(s_display, info->shared_frame, s_context, (XPointer*)&owner) != 0 || !owner ||
+                !same_image(owner, info)) {
+                info->has_frame = 0;
+                return;
+            }
 
-            return 0;
+            image = owner->ximage;
         }
+
+        if (x >= image_width || y >= image_height)
+            return;
+
+        XPutImage(s_display, info->window, s_gc, image, x, y, x, y, 
+                  min_int(width, image_width - x), min_int(height, image_height - y));
     }
+}
 
-    switch (event->type) 
-    {
-        case KeyPress:
-        {
-            sym = XLookupKeysym(&event->xkey, 0);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stores the mouse position in the coordinates of the (scaled) buffer, undoing the rotation and flips of the window.
+// w and h are the last pixel so a pixel of the window maps to exactly one pixel of the buffer.
+
+static void set_mouse_pos(WindowInfo* info, float x, float y) {
+    float w = (float)(info->buffer_width * info->scale - 1);
+    float h = (float)(info->buffer_height * info->scale - 1);
+    float fx = (info->orientation & WINDOW_FLIP_X) ? w - x : x;
+    float fy = (info->orientation & WINDOW_FLIP_Y) ? h - y : y;
+    uint32_t rotation = info->orientation & WINDOW_ROTATE_270;
+    SharedData* data = info->shared_data;
+
+    if (!data)
+        return;
 
-			if (handle_special_keys(info, event, 1))
-				break;
+    if (rotation == WINDOW_ROTATE_90) {
+        data->mouse_x = fy;
+        data->mouse_y = w - fx;
+    } else if (rotation == WINDOW_ROTATE_180) {
+        data->mouse_x = w - fx;
+        data->mouse_y = h - fy;
+    } else if (rotation == WINDOW_ROTATE_270) {
+        data->mouse_x = h - fy;
+        data->mouse_y = fx;
+    } else {
+        data->mouse_x = fx;
+        data->mouse_y = fy;
+    }
+}
 
-            if (info->key_callback)
-                info->key_callback(info->rust_data, sym, 1);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-            if (info->char_callback) {
-				unsigned int t = keySym2Unicode(sym);
-				if (t != -1)
-					info->char_callback(info->rust_data, t);
-            }
+static void set_mouse_button(WindowInfo* info, unsigned int button, int pressed) {
+    SharedData* data = info->shared_data;
 
-            break;
-        }
+    if (!data)
+        return;
 
-        case KeyRelease:
-        {
-			if (handle_special_keys(info, event, 0))
-				break;
+    if (button == Button1)
+        data->state[0] = pressed;
+    else if (button == Button2)
+        data->state[1] = pressed;
+    else if (button == Button3)
+        data->state[2] = pressed;
+    else if (!pressed)
+        return;
+    else if (button == Button4)
+        data->scroll_y = 10.0f;
+    else if (button == Button5)
+        data->scroll_y = -10.0f;
+    else if (button == Button6)
+        data->scroll_x = 10.0f;
+    else if (button == Button7)
+        data->scroll_x = -10.0f;
+}
 
-            sym = XLookupKeysym(&event->xkey, 0);
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-            if (info->key_callback)
-                info->key_callback(info->rust_data, sym, 0);
-            break;
-        }
+static void load_scroll_axes() {
+    XIDeviceInfo* devices;
+    int count, i, c;
 
-        case ButtonPress:
-        {
-            if (!info->shared_data)
-                break;
+    devices = XIQueryDevice(s_display, XIAllMasterDevices, &count);
+    s_scroll_axis_count = 0;
 
-            if (event->xbutton.button == Button1)
-                info->shared_data->state[0] = 1;
-            else if (event->xbutton.button == Button2)
-                info->shared_data->state[1] = 1;
-            else if (event->xbutton.button == Button3)
-                info->shared_data->state[2] = 1;
-            else if (event->xbutton.button == Button4)
-                info->shared_data->scroll_y = 10.0f;
-            else if (event->xbutton.button == Button5)
-                info->shared_data->scroll_y = -10.0f;
-            else if (event->xbutton.button == Button6)
-                info->shared_data->scroll_x = 10.0f;
-            else if (event->xbutton.button == Button7)
-                info->shared_data->scroll_y = -10.0f;
+    for (i = 0; i < count; ++i) {
+        for (c = 0; c < devices[i].num_classes && s_scroll_axis_count < MAX_SCROLL_AXES; ++c) {
+            XIScrollClassInfo* scroll = (XIScrollClassInfo*)devices[i].classes[c];
+            ScrollAxis* axis = &s_scroll_axes[s_scroll_axis_count];
 
-            break;
+            if (scroll->type != XIScrollClass || scroll->increment == 0.0)
+                continue;
+
+            axis->device = devices[i].deviceid;
+            axis->number = scroll->number;
+            axis->horizontal = scroll->scroll_type == XIScrollTypeHorizontal;
+            axis->increment = scroll->increment;
+            axis->has_value = 0;
+            s_scroll_axis_count++;
         }
+    }
 
-        case ButtonRelease:
-        {
-            if (!info->shared_data)
-                break;
+    XIFreeDeviceInfo(devices);
+}
 
-            if (event->xbutton.button == Button1) 
-                info->shared_data->state[0] = 0;
-            else if (event->xbutton.button == Button2)
-                info->shared_data->state[1] = 0;
-            else if (event->xbutton.button == Button3)
-                info->shared_data->state[2] = 0;
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The values of an event only hold the valuators that are set in the mask
 
-            break;
-        }
+static int get_valuator(const unsigned char* mask, int mask_len, const double* values, int number, double* value) {
+    int i, index = 0;
 
-        case ConfigureNotify:
-        {
-            info->width = event->xconfigure.width;
-            info->height = event->xconfigure.height;
-            break;
-        }
-    }
+    if (number >= mask_len * 8 || !XIMaskIsSet(mask, number))
+        return 0;
+
+    for (i = 0; i < number; ++i)
+        index += XIMaskIsSet(mask, i) ? 1 : 0;
+
+    *value = values[index];
 
     return 1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Emulated wheel buttons are skipped for devices that send the same scrolling as valuators
 
-static void get_mouse_pos(WindowInfo* info) {
-    Window root, child;
-    int rootX, rootY, childX, childY;
-    unsigned int mask;
-
-    XQueryPointer(s_display, info->window,
-                    &root, &child,
-                    &rootX, &rootY, &childX, &childY,
-                    &mask);
+static int has_scroll_axes(int device) {
+    int i;
 
-    if (info->shared_data) {
-        info->shared_data->mouse_x = (float)childX;
-        info->shared_data->mouse_y = (float)childY;
+    for (i = 0; i < s_scroll_axis_count; ++i) {
+        if (s_scroll_axes[i].device == device)
+            return 1;
     }
+
+    return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Smooth scrolling in the same units as the wheel buttons (10 per step)
 
-static int process_events()
-{
-    int count;
-    XEvent event;
-    KeySym sym;
+static void scroll_valuators(WindowInfo* info, const XIDeviceEvent* e) {
+    int i;
+
+    for (i = 0; i < s_scroll_axis_count; ++i) {
+        ScrollAxis* axis = &s_scroll_axes[i];
+        double value;
+
+        if (axis->device != e->deviceid ||
+            !get_valuator(e->valuators.mask, e->valuators.mask_len, e->valuators.values, axis->number, &value))
+            continue;
+
+        if (axis->has_value && info->shared_data) {
+            float delta = (float)((axis->value - value) / axis->increment) * 10.0f;
+
+            if (axis->horizontal)
+                info->shared_data->scroll_x += delta;
+            else
+                info->shared_data->scroll_y += delta;
+        }
+
+        axis->value = value;
+        axis->has_value = 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Adds the current position to the history. A full history keeps updating the last sample so the final position and
+// the total raw motion are still correct.
+
+static void add_pointer_sample(WindowInfo* info, Time time) {
+    PointerSample* sample;
+
+    if (!info->shared_data)
+        return;
+
+    if (info->pointer_count == POINTER_HISTORY) {
+        sample = &info->pointer_history[POINTER_HISTORY - 1];
+    } else {
+        sample = &info->pointer_history[info->pointer_count++];
+        sample->raw_x = 0.0f;
+        sample->raw_y = 0.0f;
+    }
+
+    sample->x = info->shared_data->mouse_x / info->scale;
+    sample->y = info->shared_data->mouse_y / info->scale;
+    sample->raw_x += info->raw_x;
+    sample->raw_y += info->raw_y;
+    sample->time = (uint32_t)time;
+
+    info->raw_x = 0.0f;
+    info->raw_y = 0.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Raw motion is the unaccelerated motion of the device. It's collected until the motion event of the pointer that
+// follows it.
+
+static void add_raw_motion(const XIRawEvent* e) {
+    WindowInfo* info = s_pointer_info;
+    double value;
+
+    if (!info || !info->pointer_history)
+        return;
+
+    if (get_valuator(e->valuators.mask, e->valuators.mask_len, e->raw_values, 0, &value))
+        info->raw_x += (float)value;
+
+    if (get_valuator(e->valuators.mask, e->valuators.mask_len, e->raw_values, 1, &value))
+        info->raw_y += (float)value;
+
+    info->raw_time = e->time;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void process_xinput2_event(int type, void* data) {
+    XIDeviceEvent* e = (XIDeviceEvent*)data;
+    XIEnterEvent* crossing = (XIEnterEvent*)data;
+    WindowInfo* info;
+    double value;
+    int i;
+
+    if (type == XI_RawMotion) {
+        add_raw_motion((XIRawEvent*)data);
+        return;
+    }
+
+    if (type == XI_DeviceChanged) {
+        load_scroll_axes();
+        return;
+    }
+
+    if (type == XI_Enter || type == XI_Leave) {
+        info = find_handle(crossing->event);
+
+        if (!info || !info->pointer_history)
+            return;
+
+        set_mouse_pos(info, (float)crossing->event_x, (float)crossing->event_y);
+
+        if (type == XI_Enter) {
+            s_pointer_info = info;
+
+            // The scroll valuators may have changed while the pointer was somewhere else
+            for (i = 0; i < s_scroll_axis_count; ++i)
+                s_scroll_axes[i].has_value = 0;
+        } else if (s_pointer_info == info) {
+            s_pointer_info = 0;
+        }
+
+        return;
+    }
+
+    info = find_handle(e->event);
+
+    if (!info || !info->pointer_history)
+        return;
+
+    if (info->latency_histogram && !info->latency_input)
+        info->latency_input = e->time;
+
+    if (type == XI_ButtonPress || type == XI_ButtonRelease) {
+        if (e->detail >= Button4 && (e->flags & XIPointerEmulated) && has_scroll_axes(e->deviceid))
+            return;
+
+        set_mouse_button(info, e->detail, type == XI_ButtonPress);
+    } else if (type == XI_Motion) {
+        set_mouse_pos(info, (float)e->event_x, (float)e->event_y);
+        scroll_valuators(info, e);
+
+        // Motion events are sent for scrolling as well, those don't move the pointer
+        if (get_valuator(e->valuators.mask, e->valuators.mask_len, e->valuators.values, 0, &value) ||
+            get_valuator(e->valuators.mask, e->valuators.mask_len, e->valuators.values, 1, &value))
+            add_pointer_sample(info, e->time);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// State passed to the key callback: 1 for a new press and 2 for a repeat of a held key
+
+static int press_key(WindowInfo* info, unsigned int keycode) {
+    uint8_t bit = 1 << (keycode & 7);
+    int repeat = info->keys_down[(keycode >> 3) & 31] & bit;
+
+    info->keys_down[(keycode >> 3) & 31] |= bit;
+
+    return repeat ? 2 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Without detectable auto repeat a repeat is sent as a release and a press with the same time. The release is skipped
+// so the press is seen as a repeat.
+
+static int is_repeat_release(const XEvent* event) {
+    XEvent next;
+
+    if (s_detectable_repeat || !XEventsQueued(s_display, QueuedAfterReading))
+        return 0;
+
+    XPeekEvent(s_display, &next);
+
+    return next.type == KeyPress && next.xkey.window == event->xkey.window &&
+           next.xkey.keycode == event->xkey.keycode && next.xkey.time == event->xkey.time;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void release_key(WindowInfo* info, XEvent* event) {
+    KeySym sym;
+
+    info->keys_down[(event->xkey.keycode >> 3) & 31] &= ~(1 << (event->xkey.keycode & 7));
+
+    if (handle_special_keys(info, event, 0))
+        return;
+
+    sym = XLookupKeysym(&event->xkey, 0);
+
+    if (info->key_callback)
+        info->key_callback(info->rust_data, sym, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The releases of keys that are held while the window loses the focus go to the new focus, so they're released when
+// the focus is lost instead of staying down until they're pressed again
+
+static void release_all_keys(WindowInfo* info) {
+    XEvent release;
+    unsigned int keycode;
+
+    memset(&release, 0, sizeof(release));
+    release.xkey.type = KeyRelease;
+    release.xkey.display = s_display;
+    release.xkey.window = info->window;
+
+    for (keycode = 0; keycode < 256; ++keycode) {
+        if (info->keys_down[keycode >> 3] & (1 << (keycode & 7))) {
+            release.xkey.keycode = keycode;
+            release_key(info, &release);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Server time of input events or 0 for other events
+
+static Time input_time(const XEvent* event) {
+    switch (event->type)
+    {
+        case KeyPress:
+        case KeyRelease:
+            return event->xkey.time;
+        case ButtonPress:
+        case ButtonRelease:
+            return event->xbutton.time;
+        case MotionNotify:
+            return event->xmotion.time;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int process_event(XEvent* event) {
+    KeySym sym;
+    WindowInfo* info;
+    int state;
+
+    // XInput2 events don't have the window at the same place as core events
+    if (event->type == GenericEvent) {
+        if (event->xcookie.extension == s_xi_opcode && XGetEventData(s_display, &event->xcookie)) {
+            process_xinput2_event(event->xcookie.evtype, event->xcookie.data);
+            XFreeEventData(s_display, &event->xcookie);
+        }
+
+        return 1;
+    }
+
+    info = find_handle(event->xany.window);
+
+    if (!info)
+        return 1;
+
+    // Remember the oldest input that hasn't been followed by a frame yet
+    if (info->latency_histogram && !info->latency_input)
+        info->latency_input = input_time(event);
+
+    if (event->type == ClientMessage) {
+        if ((Atom)event->xclient.data.l[0] == s_wm_delete_window) {
+            info->update = 0;
+            mfb_close(info);
+
+            return 0;
+        }
+    }
+
+    switch (event->type) 
+    {
+        case KeyPress:
+        {
+            sym = XLookupKeysym(&event->xkey, 0);
+            state = press_key(info, event->xkey.keycode);
+
+            if (handle_special_keys(info, event, state))
+                break;
+
+            if (info->key_callback)
+                info->key_callback(info->rust_data, sym, state);
+
+            if (info->char_callback) {
+				unsigned int t = keySym2Unicode(sym);
+				if (t != -1)
+					info->char_callback(info->rust_data, t);
+            }
+
+            break;
+        }
+
+        case KeyRelease:
+        {
+            if (is_repeat_release(event))
+                break;
+
+            release_key(info, event);
+            break;
+        }
+
+        // Moving the focus between the frame and the window inside it keeps the keyboard
+        case FocusOut:
+        {
+            if (event->xfocus.detail != NotifyInferior)
+                release_all_keys(info);
+            break;
+        }
+
+        case ButtonPress:
+        {
+            set_mouse_button(info, event->xbutton.button, 1);
+            break;
+        }
+
+        case ButtonRelease:
+        {
+            set_mouse_button(info, event->xbutton.button, 0);
+            break;
+        }
+
+        // Keeps the mouse position up to date for batched updates that skips XQueryPointer
+        case MotionNotify:
+        {
+            set_mouse_pos(info, event->xmotion.x, event->xmotion.y);
+            break;
+        }
+
+        case LeaveNotify:
+        {
+            set_mouse_pos(info, event->xcrossing.x, event->xcrossing.y);
+            break;
+        }
+
+        case ConfigureNotify:
+        {
+            // The window manager gives fullscreen windows the size of the monitor, the buffer stays centered
+            if (event->xconfigure.window != info->window) {
+                XMoveWindow(s_display, info->window, (event->xconfigure.width - info->width) / 2,
+                            (event->xconfigure.height - info->height) / 2);
+                break;
+            }
+
+            info->width = event->xconfigure.width;
+            info->height = event->xconfigure.height;
+            break;
+        }
+
+        // Without a window manager nothing gives the window the keyboard focus
+        case MapNotify:
+        {
+            if (info->exclusive && event->xmap.window == info->frame)
+                XSetInputFocus(s_display, info->frame, RevertToParent, CurrentTime);
+            break;
+        }
+
+        case Expose:
+        {
+            XExposeEvent* ex = &event->xexpose;
+            repaint(info, ex->x, ex->y, ex->width, ex->height);
+            break;
+        }
+
+        // Parts of the window that were obscured while being scrolled
+        case GraphicsExpose:
+        {
+            XGraphicsExposeEvent* ex = &event->xgraphicsexpose;
+            repaint(info, ex->x, ex->y, ex->width, ex->height);
+            break;
+        }
+    }
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void get_mouse_pos(WindowInfo* info) {
+    Window root, child;
+    int rootX, rootY, childX, childY;
+    unsigned int mask;
+
+    XQueryPointer(s_display, info->window,
+                    &root, &child,
+                    &rootX, &rootY, &childX, &childY,
+                    &mask);
+
+    set_mouse_pos(info, childX, childY);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Raw motion that isn't followed by a motion event (the pointer is at the edge of the screen) is added as a sample at
+// the current position once the events have been processed
+
+static void flush_raw_motion(WindowInfo* info) {
+    if (info->pointer_history && (info->raw_x != 0.0f || info->raw_y != 0.0f))
+        add_pointer_sample(info, info->raw_time);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Brings the pointer up to date after the events. Queued motion events are older than the current position so it's
+// queried, unless the pointer history is on: its motion events give the exact (sub-pixel) position already.
+
+static void update_pointer(WindowInfo* info) {
+    if (info->pointer_history)
+        flush_raw_motion(info);
+    else
+        get_mouse_pos(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int process_events()
+{
+    int count;
+    XEvent event;
+    KeySym sym;
 
     count = XPending(s_display);
 
-    while (count--)
-    {
-        XEvent event;
-        XNextEvent(s_display, &event);
-        
-        // Don't process any more messages if event is 0
-        if (process_event(&event) == 0)
-            return 0;
+    while (count--)
+    {
+        XEvent event;
+        XNextEvent(s_display, &event);
+        
+        // Don't process any more messages if event is 0
+        if (process_event(&event) == 0)
+            return 0;
+    }
+
+    return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Input that is reported per update is cleared before new events are processed
+
+static void clear_frame_input(WindowInfo* info) {
+    if (info->shared_data) {
+        info->shared_data->scroll_x = 0.0f;
+        info->shared_data->scroll_y = 0.0f;
+    }
+
+    info->pointer_count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static Bool is_latency_stamp(Display* display, XEvent* event, XPointer arg) {
+    WindowInfo* info = (WindowInfo*)arg;
+    (void)display;
+
+    return event->type == PropertyNotify && event->xproperty.window == info->window &&
+           event->xproperty.atom == s_latency_atom;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Called after a frame has been sent. The server handles requests in order, so the PropertyNotify for a property
+// changed after the frame carries the server time at which the frame has been drawn. The difference to the time of
+// the oldest input since the previous frame is counted in the histogram of the window.
+
+static void stamp_latency(WindowInfo* info) {
+    XEvent event;
+    uint32_t latency;
+    long value = 0;
+
+    if (!info->latency_histogram || !info->latency_input || !info->update)
+        return;
+
+    XChangeProperty(s_display, info->window, s_latency_atom, XA_INTEGER, 32, PropModeReplace,
+                    (unsigned char*)&value, 1);
+    XIfEvent(s_display, &event, is_latency_stamp, (XPointer)info);
+
+    // Server time is 32-bit milliseconds that wraps around
+    latency = (uint32_t)(event.xproperty.time - info->latency_input);
+
+    info->latency_histogram[latency < LATENCY_BUCKETS ? latency : LATENCY_BUCKETS - 1]++;
+    info->latency_input = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion of 0RGB source pixels into the pixel format of the visual. Done at source resolution so the cost
+// doesn't grow with the scale factor.
+
+static inline uint16_t pack_565(uint32_t p) {
+    return ((p >> 8) & 0xf800) | ((p >> 5) & 0x07e0) | ((p >> 3) & 0x001f);
+}
+
+static inline uint16_t pack_555(uint32_t p) {
+    return ((p >> 9) & 0x7c00) | ((p >> 6) & 0x03e0) | ((p >> 3) & 0x001f);
+}
+
+#if defined(__SSE2__)
+
+// 8 pixels to 16-bit. packs_epi32 saturates signed values so bias the (at most 16-bit) results around zero first
+static inline __m128i pack_16_sse2(__m128i a, __m128i b, int shift_r, int shift_g, 
+                                   uint32_t mask_r, uint32_t mask_g) {
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i mr = _mm_set1_epi32(mask_r);
+    const __m128i mg = _mm_set1_epi32(mask_g);
+    const __m128i mb = _mm_set1_epi32(0x1f);
+
+    a = _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(a, shift_r), mr),
+            _mm_and_si128(_mm_srli_epi32(a, shift_g), mg)),
+            _mm_and_si128(_mm_srli_epi32(a, 3), mb));
+    b = _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(b, shift_r), mr),
+            _mm_and_si128(_mm_srli_epi32(b, shift_g), mg)),
+            _mm_and_si128(_mm_srli_epi32(b, 3), mb));
+
+    a = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+
+    return _mm_add_epi16(a, _mm_set1_epi16((short)0x8000));
+}
+
+#endif
+
+static void convert_row_16(uint16_t* dest, const uint32_t* source, int width, int format) {
+    int x = 0;
+    int is_565 = format == PixelFormat_RGB565;
+
+#if defined(__SSE2__)
+    for (; x + 8 <= width; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(source + x));
+        __m128i b = _mm_loadu_si128((const __m128i*)(source + x + 4));
+        __m128i t = is_565 ? pack_16_sse2(a, b, 8, 5, 0xf800, 0x07e0) : pack_16_sse2(a, b, 9, 6, 0x7c00, 0x03e0);
+        _mm_storeu_si128((__m128i*)(dest + x), t);
+    }
+#endif
+
+    if (is_565) {
+        for (; x < width; ++x)
+            dest[x] = pack_565(source[x]);
+    } else {
+        for (; x < width; ++x)
+            dest[x] = pack_555(source[x]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void convert_row_24(uint8_t* dest, const uint32_t* source, int width) {
+    int x;
+
+    // Written as LSBFirst (the XImage is set up with that byte order)
+    for (x = 0; x < width; ++x) {
+        const uint32_t t = source[x];
+        dest[0] = (uint8_t)t;
+        dest[1] = (uint8_t)(t >> 8);
+        dest[2] = (uint8_t)(t >> 16);
+        dest += 3;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Horizontal scaling of one row. The vertical part is done by copying the finished row.
+
+static void expand_row_32(uint32_t* dest, const uint32_t* source, int width, int scale) {
+    int x = 0, i;
+
+    if (scale == 1) {
+        memcpy(dest, source, width * 4);
+        return;
+    }
+
+#if defined(__SSE2__)
+    if (scale == 2) {
+        for (; x + 4 <= width; x += 4) {
+            __m128i t = _mm_loadu_si128((const __m128i*)(source + x));
+            _mm_storeu_si128((__m128i*)(dest + 0), _mm_unpacklo_epi32(t, t));
+            _mm_storeu_si128((__m128i*)(dest + 4), _mm_unpackhi_epi32(t, t));
+            dest += 8;
+        }
+    } else if ((scale & 3) == 0) {
+        for (; x < width; ++x) {
+            __m128i t = _mm_set1_epi32((int)source[x]);
+
+            for (i = 0; i < scale; i += 4)
+                _mm_storeu_si128((__m128i*)(dest + i), t);
+
+            dest += scale;
+        }
+    }
+#endif
+
+    for (; x < width; ++x) {
+        const uint32_t t = source[x];
+
+        for (i = 0; i < scale; ++i)
+            dest[i] = t;
+
+        dest += scale;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void expand_row_16(uint16_t* dest, const uint16_t* source, int width, int scale) {
+    int x = 0, i;
+
+#if defined(__SSE2__)
+    if (scale == 2) {
+        for (; x + 8 <= width; x += 8) {
+            __m128i t = _mm_loadu_si128((const __m128i*)(source + x));
+            _mm_storeu_si128((__m128i*)(dest + 0), _mm_unpacklo_epi16(t, t));
+            _mm_storeu_si128((__m128i*)(dest + 8), _mm_unpackhi_epi16(t, t));
+            dest += 16;
+        }
+    } else if ((scale & 7) == 0) {
+        for (; x < width; ++x) {
+            __m128i t = _mm_set1_epi16((short)source[x]);
+
+            for (i = 0; i < scale; i += 8)
+                _mm_storeu_si128((__m128i*)(dest + i), t);
+
+            dest += scale;
+        }
+    }
+#endif
+
+    for (; x < width; ++x) {
+        const uint16_t t = source[x];
+
+        for (i = 0; i < scale; ++i)
+            dest[i] = t;
+
+        dest += scale;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void expand_row_24(uint8_t* dest, const uint8_t* source, int width, int scale) {
+    int x, i;
+
+    for (x = 0; x < width; ++x) {
+        for (i = 0; i < scale; ++i) {
+            dest[0] = source[0];
+            dest[1] = source[1];
+            dest[2] = source[2];
+            dest += 3;
+        }
+
+        source += 3;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes one source row as one row in the draw buffer. Formats that needs conversion goes through the line buffer
+// (a single row at source resolution) so there is no full frame intermediate.
+
+static void convert_row(WindowInfo* info, void* dest, const uint32_t* source, int width, int scale) {
+    switch (s_pixel_format) {
+        case PixelFormat_RGB32: {
+            expand_row_32((uint32_t*)dest, source, width, scale);
+            break;
+        }
+        case PixelFormat_RGB24: {
+            if (scale == 1) {
+                convert_row_24((uint8_t*)dest, source, width);
+            } else {
+                convert_row_24((uint8_t*)info->line_buffer, source, width);
+                expand_row_24((uint8_t*)dest, (uint8_t*)info->line_buffer, width, scale);
+            }
+            break;
+        }
+        case PixelFormat_RGB565:
+        case PixelFormat_RGB555: {
+            if (scale == 1) {
+                convert_row_16((uint16_t*)dest, source, width, s_pixel_format);
+            } else {
+                convert_row_16((uint16_t*)info->line_buffer, source, width, s_pixel_format);
+                expand_row_16((uint16_t*)dest, (uint16_t*)info->line_buffer, width, scale);
+            }
+            break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Color transform applied to the source rows before they are converted and scaled. It runs on one row at a time so
+// it doesn't add another pass over the frame.
+
+static void apply_color_curves(const uint8_t* curves, uint32_t* dest, const uint32_t* source, int width) {
+    int x;
+
+    for (x = 0; x < width; ++x) {
+        uint32_t p = source[x];
+        dest[x] = ((uint32_t)curves[(p >> 16) & 0xff] << 16) | 
+                  ((uint32_t)curves[256 + ((p >> 8) & 0xff)] << 8) | 
+                  curves[512 + (p & 0xff)];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Interpolates one channel along the path c0 -> c1 -> c2 -> c3 through a tetrahedron of the lut (weights are 0 - 256)
+
+static inline uint32_t tetra_channel(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, int shift, 
+                                     int w1, int w2, int w3) {
+    int v0 = (c0 >> shift) & 0xff;
+    int v1 = (c1 >> shift) & 0xff;
+    int v2 = (c2 >> shift) & 0xff;
+    int v3 = (c3 >> shift) & 0xff;
+    int v = (v0 << 8) + (w1 * (v1 - v0)) + (w2 * (v2 - v1)) + (w3 * (v3 - v2));
+
+    return (uint32_t)((v + 128) >> 8) << shift;
+}
+
+static inline uint32_t tetra_lookup(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, int w1, int w2, int w3) {
+    return tetra_channel(c0, c1, c2, c3, 16, w1, w2, w3) |
+           tetra_channel(c0, c1, c2, c3, 8, w1, w2, w3) |
+           tetra_channel(c0, c1, c2, c3, 0, w1, w2, w3);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 3D lut with tetrahedral interpolation. The lut has size^3 entries with red changing fastest.
+
+static void apply_color_lut(const uint32_t* lut, int size, uint32_t* dest, const uint32_t* source, int width) {
+    int g_step = size;
+    int b_step = size * size;
+    int x;
+
+    for (x = 0; x < width; ++x) {
+        uint32_t p = source[x];
+        // Positions in the lut in 8.8 fixed point
+        int r = (((p >> 16) & 0xff) * (size - 1) * 256) / 255;
+        int g = (((p >> 8) & 0xff) * (size - 1) * 256) / 255;
+        int b = ((p & 0xff) * (size - 1) * 256) / 255;
+        int ri = min_int(r >> 8, size - 2), gi = min_int(g >> 8, size - 2), bi = min_int(b >> 8, size - 2);
+        int fr = r - (ri << 8), fg = g - (gi << 8), fb = b - (bi << 8);
+        const uint32_t* c = lut + ri + (gi * g_step) + (bi * b_step);
+        uint32_t c000 = c[0];
+        uint32_t c111 = c[1 + g_step + b_step];
+
+        if (fr >= fg) {
+            if (fg >= fb)
+                dest[x] = tetra_lookup(c000, c[1], c[1 + g_step], c111, fr, fg, fb);
+            else if (fr >= fb)
+                dest[x] = tetra_lookup(c000, c[1], c[1 + b_step], c111, fr, fb, fg);
+            else
+                dest[x] = tetra_lookup(c000, c[b_step], c[1 + b_step], c111, fb, fr, fg);
+        } else {
+            if (fb >= fg)
+                dest[x] = tetra_lookup(c000, c[b_step], c[g_step + b_step], c111, fb, fg, fr);
+            else if (fb >= fr)
+                dest[x] = tetra_lookup(c000, c[g_step], c[g_step + b_step], c111, fg, fb, fr);
+            else
+                dest[x] = tetra_lookup(c000, c[g_step], c[1 + g_step], c111, fg, fr, fb);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the source row with the color transform of the window applied
+
+static const uint32_t* transform_row(WindowInfo* info, const uint32_t* source, int width) {
+    if (info->color_curves) {
+        apply_color_curves(info->color_curves, info->color_buffer, source, width);
+        source = info->color_buffer;
+    }
+
+    if (info->color_lut) {
+        apply_color_lut(info->color_lut, info->color_lut_size, info->color_buffer, source, width);
+        source = info->color_buffer;
+    }
+
+    return source;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Conversion of YUV 4:2:0 to 0RGB. Each chroma sample covers 2x2 pixels. The math is 16-bit fixed point that the
+// SSE2 version does 8 pixels at a time: the inputs are shifted up 7 bits and multiplied with the 2.13 factors keeping
+// the high half (_mm_mulhi_epi16), which leaves the channels with 4 fractional bits. The plain C version does the
+// same steps so both give identical results.
+
+static inline int yuv_mul(int value, int factor) {
+    return (value * factor) >> 16;
+}
+
+static inline uint32_t yuv_pixel(const int16_t* c, int y, int u, int v) {
+    int luma = yuv_mul((y - c[0]) << 7, c[1]);
+    int r, g, b;
+
+    u = (u - 128) << 7;
+    v = (v - 128) << 7;
+
+    r = (luma + yuv_mul(v, c[2]) + 8) >> 4;
+    g = (luma + yuv_mul(u, c[3]) + yuv_mul(v, c[4]) + 8) >> 4;
+    b = (luma + yuv_mul(u, c[5]) + 8) >> 4;
+
+    r = r < 0 ? 0 : (r > 255 ? 255 : r);
+    g = g < 0 ? 0 : (g > 255 ? 255 : g);
+    b = b < 0 ? 0 : (b > 255 ? 255 : b);
+
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+}
+
+// Converts columns x0 to x1 of row y of the frame into dest
+
+static void convert_yuv_row(const YuvFrame* frame, uint32_t* dest, int x0, int x1, int y) {
+    const uint8_t* luma = frame->planes[0] + ((ptrdiff_t)y * frame->strides[0]);
+    const uint8_t* u_row = frame->planes[1] + ((ptrdiff_t)(y >> 1) * frame->strides[1]);
+    const uint8_t* v_row = frame->nv12 ? u_row + 1 : frame->planes[2] + ((ptrdiff_t)(y >> 1) * frame->strides[2]);
+    int chroma_step = frame->nv12 ? 2 : 1;
+    const int16_t* c = frame->coeffs;
+    int x = x0;
+
+    // The SSE2 loop starts at a pixel that begins a chroma sample
+    if ((x & 1) && x < x1) {
+        *dest++ = yuv_pixel(c, luma[x], u_row[(x >> 1) * chroma_step], v_row[(x >> 1) * chroma_step]);
+        x++;
+    }
+
+#if defined(__SSE2__)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i low_mask = _mm_set1_epi32(0xffff);
+        const __m128i y_offset = _mm_set1_epi16(c[0]);
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i round = _mm_set1_epi16(8);
+        const __m128i y_factor = _mm_set1_epi16(c[1]);
+        const __m128i rv = _mm_set1_epi16(c[2]);
+        const __m128i gu = _mm_set1_epi16(c[3]);
+        const __m128i gv = _mm_set1_epi16(c[4]);
+        const __m128i bu = _mm_set1_epi16(c[5]);
+
+        for (; x + 8 <= x1; x += 8) {
+            __m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(luma + x)), zero);
+            __m128i u, v, r, g, b, bg, r0;
+
+            // Both ways end up with each chroma sample in two 16-bit lanes
+            if (frame->nv12) {
+                __m128i uv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(u_row + x)), zero);
+                u = _mm_and_si128(uv, low_mask);
+                v = _mm_srli_epi32(uv, 16);
+                u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+                v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+            } else {
+                int32_t u4, v4;
+                memcpy(&u4, u_row + (x >> 1), 4);
+                memcpy(&v4, v_row + (x >> 1), 4);
+                u = _mm_cvtsi32_si128(u4);
+                v = _mm_cvtsi32_si128(v4);
+                u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(u, u), zero);
+                v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(v, v), zero);
+            }
+
+            l = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(l, y_offset), 7), y_factor);
+            u = _mm_slli_epi16(_mm_sub_epi16(u, c128), 7);
+            v = _mm_slli_epi16(_mm_sub_epi16(v, c128), 7);
+
+            r = _mm_add_epi16(l, _mm_mulhi_epi16(v, rv));
+            g = _mm_add_epi16(_mm_add_epi16(l, _mm_mulhi_epi16(u, gu)), _mm_mulhi_epi16(v, gv));
+            b = _mm_add_epi16(l, _mm_mulhi_epi16(u, bu));
+
+            r = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(r, round), 4), zero);
+            g = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(g, round), 4), zero);
+            b = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(b, round), 4), zero);
+
+            bg = _mm_unpacklo_epi8(b, g);
+            r0 = _mm_unpacklo_epi8(r, zero);
+            _mm_storeu_si128((__m128i*)(dest + 0), _mm_unpacklo_epi16(bg, r0));
+            _mm_storeu_si128((__m128i*)(dest + 4), _mm_unpackhi_epi16(bg, r0));
+            dest += 8;
+        }
+    }
+#endif
+
+    for (; x < x1; ++x)
+        *dest++ = yuv_pixel(c, luma[x], u_row[(x >> 1) * chroma_step], v_row[(x >> 1) * chroma_step]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Looks up the colors of an indexed row. SSE2 has no gather so this is plain loads from the palette, which stays in
+// the L1 cache, four pixels per iteration.
+
+static void expand_indexed_row(const uint32_t* palette, uint32_t* dest, const uint8_t* source, int width) {
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        uint32_t c0 = palette[source[x + 0]];
+        uint32_t c1 = palette[source[x + 1]];
+        uint32_t c2 = palette[source[x + 2]];
+        uint32_t c3 = palette[source[x + 3]];
+        dest[x + 0] = c0;
+        dest[x + 1] = c1;
+        dest[x + 2] = c2;
+        dest[x + 3] = c3;
+    }
+
+    for (; x < width; ++x)
+        dest[x] = palette[source[x]];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gathers rows y0 to y0 + rows of the rotated/flipped image (columns x0 to x1) from the input buffer into the orient
+// buffer. The loops follow the axis that is contiguous in the input so for rotations each input row is read
+// ORIENT_BLOCK pixels (a cache line) at a time while the rows being written stay in the cache.
+
+static void orient_rows(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int x1, int y0, int rows)
+{
+    ptrdiff_t step_x = info->map_x[0] + ((ptrdiff_t)info->map_y[0] * stride);
+    ptrdiff_t step_y = info->map_x[1] + ((ptrdiff_t)info->map_y[1] * stride);
+    const uint32_t* source = buffer + info->map_x[2] + ((ptrdiff_t)info->map_y[2] * stride) + (y0 * step_y) + 
+                             (x0 * step_x);
+    int pitch = info->buffer_width;
+    int width = x1 - x0;
+    int x, y;
+
+    if (step_x == 1 || step_x == -1) {
+        for (y = 0; y < rows; ++y) {
+            const uint32_t* s = source + (y * step_y);
+            uint32_t* dest = info->orient_buffer + (y * pitch);
+
+            for (x = 0; x < width; ++x)
+                dest[x] = s[x * step_x];
+        }
+    } else {
+        for (x = 0; x < width; ++x) {
+            const uint32_t* s = source + (x * step_x);
+            uint32_t* dest = info->orient_buffer + x;
+
+            for (y = 0; y < rows; ++y)
+                dest[y * pitch] = s[y * step_y];
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns row y (columns x0 to x1) of the window oriented image when walking rows first_y to y1. Rotated or flipped
+// rows are gathered a block at a time.
+
+static const uint32_t* source_row(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int x1, 
+                                  int y, int first_y, int y1)
+{
+    int block_row;
+
+    // YUV and indexed frames are converted a row at a time right before the row is scaled
+    if (info->yuv) {
+        convert_yuv_row(info->yuv, info->input_row, x0, x1, y);
+        return info->input_row;
+    }
+
+    if (info->index_pass) {
+        expand_indexed_row(info->palette, info->input_row, info->indices + (y * info->input_width) + x0, x1 - x0);
+        return info->input_row;
+    }
+
+    if (!info->orientation)
+        return buffer + (y * stride) + x0;
+
+    block_row = (y - first_y) % ORIENT_BLOCK;
+
+    if (block_row == 0)
+        orient_rows(info, buffer, stride, x0, x1, y, min_int(ORIENT_BLOCK, y1 - y));
+
+    return info->orient_buffer + (block_row * info->buffer_width);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Post effects applied to the scaled rows while they are written. Scanlines darken the lower half of each scaled
+// row, the shadow mask is an aperture grille where each column dims two of the channels and edge blending averages
+// the first column and row of each scaled pixel with the pixel before it. The mask and scanlines are a multiplier
+// per channel (8.8 fixed point, blue first) for each column in a period. They're stored for EFFECT_COLUMNS columns
+// so a period can start at any phase of the mask.
+
+static inline uint32_t average_pixel(uint32_t a, uint32_t b) {
+    return (a & b) + (((a ^ b) & 0xfefefefe) >> 1);
+}
+
+static void apply_effect_factors(uint32_t* dest, const uint32_t* source, int width, const uint16_t* factors) {
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i f[6];
+    int i;
+
+    for (i = 0; i < 6; ++i)
+        f[i] = _mm_loadu_si128((const __m128i*)(factors + (i * 8)));
+
+    for (; x + EFFECT_PERIOD <= width; x += EFFECT_PERIOD) {
+        for (i = 0; i < 3; ++i) {
+            __m128i p = _mm_loadu_si128((const __m128i*)(source + x + (i * 4)));
+            __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), f[i * 2 + 0]), 8);
+            __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), f[i * 2 + 1]), 8);
+            _mm_storeu_si128((__m128i*)(dest + x + (i * 4)), _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+
+    for (; x < width; ++x) {
+        const uint16_t* f = factors + ((x % EFFECT_PERIOD) * 4);
+        const uint32_t p = source[x];
+
+        dest[x] = (((p & 0xff) * f[0]) >> 8) |
+                  (((((p >> 8) & 0xff) * f[1]) >> 8) << 8) |
+                  (((((p >> 16) & 0xff) * f[2]) >> 8) << 16) |
+                  ((((p >> 24) * f[3]) >> 8) << 24);
+    }
+}
+
+// Scales the row horizontally, with edge blending the first column of each pixel is blended with the pixel to the
+// left of it. source has one pixel before the row when left is set.
+
+static void expand_row_effects(WindowInfo* info, uint32_t* dest, const uint32_t* source, int width, int left) {
+    int scale = info->draw_scale;
+    int x;
+
+    expand_row_32(dest, source + left, width, scale);
+
+    if (!info->effect_edge_blend)
+        return;
+
+    for (x = 1 - left; x < width; ++x)
+        dest[x * scale] = average_pixel(source[left + x - 1], source[left + x]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Same as scale_rect but with the post effects. Each scaled row is built at 32-bit in the effect buffer (or directly
+// in the draw buffer for 32-bit visuals), rows of a pixel that end up the same are copied.
+
+static void scale_rect_effects(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int y0, int x1, int y1, 
+                               int dest_y)
+{
+    int scale = info->draw_scale;
+    int left = (info->effect_edge_blend && x0 > 0) ? 1 : 0;
+    int width = x1 - x0;
+    int scaled_width = width * scale;
+    int pitch = info->ximage->bytes_per_line;
+    int row_size = scaled_width * s_bytes_per_pixel;
+    int scan_row = info->effect_scanlines ? (scale + 1) / 2 : scale;
+    int has_factors = info->effect_scanlines || info->effect_mask;
+    int phase = (x0 * scale) % 3;
+    int direct = s_pixel_format == PixelFormat_RGB32;
+    int has_prev = info->effect_edge_blend && y0 > 0;
+    uint32_t* prev = info->effect_buffer;
+    uint32_t* base = prev + info->buffer_width + 1;
+    uint32_t* top = base + (info->buffer_width * scale);
+    uint32_t* out = top + (info->buffer_width * scale);
+    char* dest = (char*)info->draw_buffer + (dest_y * scale * pitch) + (x0 * scale * s_bytes_per_pixel);
+    const uint32_t* source;
+    int y, x, i;
+
+    // The first row of the rectangle is blended with the row above it
+    if (has_prev) {
+        source = source_row(info, buffer, stride, x0 - left, x1, y0 - 1, y0 - 1, y0);
+        memcpy(prev, transform_row(info, source, width + left), (width + left) * 4);
+    }
+
+    for (y = y0; y < y1; ++y) {
+        int prev_kind = -1;
+
+        source = source_row(info, buffer, stride, x0 - left, x1, y, y0, y1);
+        source = transform_row(info, source, width + left);
+
+        expand_row_effects(info, base, source, width, left);
+
+        if (has_prev) {
+            for (x = 0; x < width + left; ++x)
+                prev[x] = average_pixel(prev[x], source[x]);
+
+            expand_row_effects(info, top, prev, width, left);
+        }
+
+        for (i = 0; i < scale; ++i) {
+            // 0 = blended top row, 1 = plain and 2 = scanline
+            int kind = (i == 0 && has_prev) ? 0 : (i >= scan_row ? 2 : 1);
+            char* d = dest + (i * pitch);
+            const uint32_t* row = kind == 0 ? top : base;
+
+            if (kind == prev_kind) {
+                memcpy(d, d - pitch, row_size);
+                continue;
+            }
+
+            if (has_factors) {
+                uint32_t* target = direct ? (uint32_t*)d : out;
+                apply_effect_factors(target, row, scaled_width, info->effect_factors[kind == 2][phase]);
+                row = target;
+            }
+
+            if (row != (const uint32_t*)d)
+                convert_row(info, d, row, scaled_width, 1);
+
+            prev_kind = kind;
+        }
+
+        memcpy(prev, source, (width + left) * 4);
+        has_prev = info->effect_edge_blend;
+        dest += pitch * scale;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scales the rectangle x0, y0 - x1, y1 of the window oriented image into the draw buffer starting at row dest_y. The
+// buffer is always the full input buffer (rotated or flipped while reading it if needed).
+
+static void scale_rect(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int y0, int x1, int y1, 
+                       int dest_y)
+{
+    int scale = info->draw_scale;
+    int width = x1 - x0;
+    int pitch = info->ximage->bytes_per_line;
+    int row_size = width * scale * s_bytes_per_pixel;
+    char* dest = (char*)info->draw_buffer + (dest_y * scale * pitch) + (x0 * scale * s_bytes_per_pixel);
+    int y, i;
+
+    if (info->effect_buffer) {
+        scale_rect_effects(info, buffer, stride, x0, y0, x1, y1, dest_y);
+        return;
+    }
+
+    for (y = y0; y < y1; ++y) {
+        const uint32_t* source = source_row(info, buffer, stride, x0, x1, y, y0, y1);
+
+        convert_row(info, dest, transform_row(info, source, width), width, scale);
+
+        for (i = 1; i < scale; ++i)
+            memcpy(dest + (i * pitch), dest, row_size);
+
+        dest += pitch * scale;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void scale_rows(WindowInfo* info, const uint32_t* buffer, int stride, int y0, int y1)
+{
+    scale_rect(info, buffer, stride, 0, y0, info->buffer_width, y1, y0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scales and uploads a rectangle of the buffer through the (band sized) draw buffer. XPutImage copies the data to the
+// request buffer so the band can be reused directly.
+
+static void put_banded(WindowInfo* info, const uint32_t* buffer, int stride, int x0, int y0, int x1, int y1, 
+                       Drawable target)
+{
+    int scale = info->draw_scale;
+    int y;
+
+    for (y = y0; y < y1; y += info->band_rows) {
+        int rows = min_int(info->band_rows, y1 - y);
+
+        scale_rect(info, buffer, stride, x0, y, x1, y + rows, 0);
+        XPutImage(s_display, target, s_gc, info->ximage, x0 * scale, 0, x0 * scale, y * scale, 
+                  (x1 - x0) * scale, rows * scale);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void put_rows(WindowInfo* info, XImage* image, int y0, int y1)
+{
+    int width = info->buffer_width * info->scale;
+    int y = y0 * info->scale;
+    int height = (y1 - y0) * info->scale;
+
+    if (info->src_picture) {
+        XPutImage(s_display, info->pixmap, s_gc, image, 0, y0, 0, y0, info->buffer_width, y1 - y0);
+        XRenderComposite(s_display, PictOpSrc, info->src_picture, None, info->window_picture,
+                         0, y, 0, 0, 0, y, width, height);
+    } else if (info->pixmap) {
+        XPutImage(s_display, info->pixmap, s_gc, image, 0, y, 0, y, width, height);
+        XCopyArea(s_display, info->pixmap, info->window, s_gc, 0, y, width, height, 0, y);
+    } else {
+        XPutImage(s_display, info->window, s_gc, image, 0, y, 0, y, width, height);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Finds the range of rows that differs from the previous frame and updates the copy of it.
+// Returns 0 if the frame is unchanged.
+
+static int find_dirty_rows(WindowInfo* info, const uint32_t* buffer, int stride, int* y0, int* y1)
+{
+    int width = info->input_width;
+    int height = info->input_height;
+    size_t row_size = width * 4;
+    int first = 0, last = height, y;
+
+    if (info->has_frame) {
+        while (first < height && !memcmp(info->prev_buffer + first * width, buffer + first * stride, row_size))
+            first++;
+
+        if (first == height)
+            return 0;
+
+        while (last > first && !memcmp(info->prev_buffer + (last - 1) * width, buffer + (last - 1) * stride, row_size))
+            last--;
+    }
+
+    for (y = first; y < last; ++y)
+        memcpy(info->prev_buffer + y * width, buffer + y * stride, row_size);
+
+    *y0 = first;
+    *y1 = last;
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Finds the rows of the (window oriented) image that needs to be uploaded. Returns 0 if nothing has changed.
+
+static int find_pending_rows(WindowInfo* info, const uint32_t* buffer, int stride, int* pending_y0, int* pending_y1)
+{
+    int y0 = 0;
+    int y1 = info->buffer_height;
+
+    if (info->prev_buffer && !find_dirty_rows(info, buffer, stride, &y0, &y1))
+        return 0;
+
+    // With edge blending the row below the changed ones is blended with them
+    if (info->effect_edge_blend && y1 < info->input_height)
+        y1++;
+
+    // The changed input rows are spread over the whole rotated/flipped image
+    if (info->orientation) {
+        y0 = 0;
+        y1 = info->buffer_height;
+    }
+
+    *pending_y0 = y0;
+    *pending_y1 = y1;
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Converts and scales the buffer into the draw buffer. This doesn't talk to the X server so it's safe to call
+// for different windows on different threads. Returns 1 if there is something to upload. In banded mode the
+// scaling is done while uploading instead.
+// stride is the distance in pixels between rows in buffer (0 for a tightly packed buffer)
+
+int mfb_prepare_buffer(void* window_info, void* buffer, int stride)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    int y0, y1;
+
+    info->pending_buffer = 0;
+
+    if (!info->update || !buffer)
+        return 0;
+
+    if (stride <= 0)
+        stride = info->input_width;
+
+    if (!find_pending_rows(info, (const uint32_t*)buffer, stride, &y0, &y1))
+        return 0;
+
+    if (info->draw_buffer && !info->band_rows)
+        scale_rows(info, (const uint32_t*)buffer, stride, y0, y1);
+
+    info->pending_buffer = buffer;
+    info->pending_stride = stride;
+    info->pending_y0 = y0;
+    info->pending_y1 = y1;
+    info->has_frame = 1;
+    info->shared_frame = 0;
+    info->indexed_frame = 0;
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queues the upload of the prepared rows. The pending buffer is kept so the caller knows which windows have output
+// and is cleared with clear_prepared once the requests have been flushed.
+
+static void put_prepared(WindowInfo* info)
+{
+    if (!info->pending_buffer)
+        return;
+
+    if (info->band_rows) {
+        int y0 = info->pending_y0;
+        int y1 = info->pending_y1;
+        int scale = info->scale;
+
+        put_banded(info, (const uint32_t*)info->pending_buffer, info->pending_stride, 0, y0, info->buffer_width, y1,
+                   info->pixmap ? info->pixmap : info->window);
+
+        if (info->pixmap) {
+            XCopyArea(s_display, info->pixmap, info->window, s_gc, 0, y0 * scale, 
+                      info->width, (y1 - y0) * scale, 0, y0 * scale);
+        }
+    } else if (!info->draw_buffer) {
+        int bytes_per_line = info->ximage->bytes_per_line;
+
+        info->ximage->data = (char*)info->pending_buffer;
+        info->ximage->bytes_per_line = info->pending_stride * 4;
+        put_rows(info, info->ximage, info->pending_y0, info->pending_y1);
+        info->ximage->data = NULL;
+        info->ximage->bytes_per_line = bytes_per_line;
+    } else {
+        put_rows(info, info->pending_image ? info->pending_image : info->ximage, info->pending_y0, info->pending_y1);
+    }
+}
+
+static void clear_prepared(WindowInfo* info)
+{
+    info->pending_buffer = 0;
+    info->pending_image = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Same clock as the Rust side of the trace (CLOCK_MONOTONIC)
+
+static uint64_t trace_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reports the phase that started at begin and returns its end as the begin of the next phase
+
+static uint64_t trace_end(WindowInfo* info, int phase, uint64_t begin) {
+    uint64_t end;
+
+    if (!s_trace)
+        return 0;
+
+    end = trace_now();
+    s_trace(info, phase, begin, end);
+    return end;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_set_trace_callback(void (*callback)(void* window, int phase, uint64_t begin, uint64_t end))
+{
+    s_trace = callback;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Presents a prepared frame and processes the events. t is the time the update started at (when tracing).
+
+static void present_update(WindowInfo* info, int prepared, uint64_t t)
+{
+    if (prepared) {
+        int has_output = info->pending_buffer != 0;
+
+        t = trace_end(info, TracePhase_Prepare, t);
+        put_prepared(info);
+        t = trace_end(info, TracePhase_Put, t);
+        XFlush(s_display);
+        t = trace_end(info, TracePhase_Flush, t);
+        clear_prepared(info);
+
+        if (has_output) {
+            stamp_latency(info);
+            t = trace_end(info, TracePhase_Latency, t);
+        }
+    }
+
+    // clear before processing new events
+
+    clear_frame_input(info);
+
+    process_events();
+    t = trace_end(info, TracePhase_Events, t);
+
+    if (info->update) {
+        update_pointer(info);
+        trace_end(info, TracePhase_Pointer, t);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_update_with_buffer_stride(void* window_info, void* buffer, int stride)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    uint64_t t = s_trace ? trace_now() : 0;
+
+    present_update(info, mfb_prepare_buffer(info, buffer, stride), t);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void mfb_update_with_buffer(void* window_info, void* buffer)
+{
+    mfb_update_with_buffer_stride(window_info, buffer, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Windows that upload directly from the input buffer (server side scaling) switch to using a draw buffer when they
+// need one to write converted rows to
+
+static int ensure_draw_buffer(WindowInfo* info)
+{
+    if (!info->draw_buffer) {
+        info->draw_buffer = malloc(info->ximage->bytes_per_line * info->ximage->height);
+        info->ximage->data = (char*)info->draw_buffer;
+    }
+
+    return info->draw_buffer != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Buffers for YUV and indexed input. Rotated or flipped windows and windows that keep a copy of the last frame (retain
+// and banded) need the whole frame as 0RGB so it's converted into a source sized buffer for them. Others convert each
+// row while it's scaled.
+
+static int alloc_input_buffers(WindowInfo* info)
+{
+    if (info->orientation || info->prev_buffer) {
+        if (!info->input_buffer)
+            info->input_buffer = (uint32_t*)malloc(info->input_width * info->input_height * 4);
+
+        return info->input_buffer != 0;
+    }
+
+    if (!info->input_row)
+        info->input_row = (uint32_t*)malloc(info->buffer_width * 4);
+
+    return ensure_draw_buffer(info) && info->input_row;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int prepare_yuv(WindowInfo* info, const YuvFrame* frame)
+{
+    int y;
+
+    info->pending_buffer = 0;
+
+    if (!info->update)
+        return 0;
+
+    if (info->input_buffer) {
+        for (y = 0; y < info->input_height; ++y)
+            convert_yuv_row(frame, info->input_buffer + (y * info->input_width), 0, info->input_width, y);
+
+        return mfb_prepare_buffer(info, info->input_buffer, 0);
+    }
+
+    info->yuv = frame;
+    scale_rows(info, 0, 0, 0, info->buffer_height);
+    info->yuv = 0;
+
+    // The frame is only used as a marker here, put_prepared uploads the draw buffer
+    info->pending_buffer = (void*)frame;
+    info->pending_stride = 0;
+    info->pending_y0 = 0;
+    info->pending_y1 = info->buffer_height;
+    info->has_frame = 1;
+    info->shared_frame = 0;
+    info->indexed_frame = 0;
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Updates the window with a YUV 4:2:0 frame of the size of the buffer. For NV12 u_plane holds the interleaved U and V
+// samples and v_plane isn't used. Returns 0 if the buffers needed for the conversion couldn't be allocated.
+
+int mfb_update_with_yuv(void* window_info, const uint8_t* y_plane, int y_stride, const uint8_t* u_plane, int u_stride,
+                        const uint8_t* v_plane, int v_stride, int nv12, const int16_t* coeffs)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    uint64_t t = s_trace ? trace_now() : 0;
+    YuvFrame frame;
+
+    // A closed window has no image left to convert into, prepare_yuv skips it
+    if (info->update && !alloc_input_buffers(info))
+        return 0;
+
+    frame.planes[0] = y_plane;
+    frame.planes[1] = u_plane;
+    frame.planes[2] = v_plane;
+    frame.strides[0] = y_stride;
+    frame.strides[1] = u_stride;
+    frame.strides[2] = v_stride;
+    frame.nv12 = nv12;
+    memcpy(frame.coeffs, coeffs, sizeof(frame.coeffs));
+
+    present_update(info, prepare_yuv(info, &frame), t);
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies the rows of indices that differ from the cached frame into the cache and returns the range of them. All rows
+// are copied when full is set.
+
+static void update_index_cache(WindowInfo* info, const uint8_t* indices, int full, int* y0, int* y1)
+{
+    int width = info->input_width;
+    int first = 0, last = info->input_height;
+
+    if (!full) {
+        while (first < last && !memcmp(info->indices + (first * width), indices + (first * width), width))
+            first++;
+
+        while (last > first && !memcmp(info->indices + ((last - 1) * width), indices + ((last - 1) * width), width))
+            last--;
+    }
+
+    memcpy(info->indices + (first * width), indices + (first * width), (last - first) * width);
+
+    *y0 = first;
+    *y1 = last;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Converts the rows of the cached indexed frame that changed. indices is 0 when only the palette has changed.
+
+static int prepare_indexed(WindowInfo* info, const uint8_t* indices)
+{
+    // Only the changed rows are redrawn when the screen shows the cached frame with the current palette
+    int full = !info->has_frame || info->shared_frame || !info->indexed_frame || info->palette_changed;
+    int y0 = 0, y1 = info->input_height, y;
+    int width = info->input_width;
+    int prepared;
+
+    info->pending_buffer = 0;
+
+    if (!info->update)
+        return 0;
+
+    if (indices)
+        update_index_cache(info, indices, full, &y0, &y1);
+
+    info->palette_changed = 0;
+
+    if (y0 == y1)
+        return 0;
+
+    if (info->input_buffer) {
+        for (y = y0; y < y1; ++y)
+            expand_indexed_row(info->palette, info->input_buffer + (y * width), info->indices + (y * width), width);
+
+        prepared = mfb_prepare_buffer(info, info->input_buffer, 0);
+        info->indexed_frame = 1;
+        return prepared;
+    }
+
+    // With edge blending the row below the changed ones is blended with them
+    if (info->effect_edge_blend && y1 < info->input_height)
+        y1++;
+
+    info->index_pass = 1;
+    scale_rows(info, 0, 0, y0, y1);
+    info->index_pass = 0;
+
+    // As for YUV frames the cache is only a marker, put_prepared uploads the draw buffer
+    info->pending_buffer = info->indices;
+    info->pending_stride = 0;
+    info->pending_y0 = y0;
+    info->pending_y1 = y1;
+    info->has_frame = 1;
+    info->shared_frame = 0;
+    info->indexed_frame = 1;
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Updates the window with a frame of 8-bit palette indices of the size of the buffer. The frame is cached so that
+// passing 0 for indices redraws it after the palette has changed. Returns 0 if the buffers couldn't be allocated or if
+// there is no cached frame to redraw.
+
+int mfb_update_with_indexed(void* window_info, const uint8_t* indices)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    uint64_t t = s_trace ? trace_now() : 0;
+
+    // A closed window only processes the pending events, like update_with_buffer
+    if (!info->update) {
+        present_update(info, 0, t);
+        return 1;
+    }
+
+    if (!indices && !info->indices)
+        return 0;
+
+    if (!info->indices)
+        info->indices = (uint8_t*)malloc(info->input_width * info->input_height);
+
+    if (!info->indices || !alloc_input_buffers(info))
+        return 0;
+
+    present_update(info, prepare_indexed(info, indices), t);
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Replaces count entries of the palette starting at first. The next indexed update redraws the whole frame.
+
+void mfb_set_palette(void* window_info, const uint32_t* colors, int first, int count)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+
+    memcpy(info->palette + first, colors, count * 4);
+    info->palette_changed = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Moves the already converted pixels of the draw buffer that are still visible after a scroll
+
+static void move_draw_buffer(WindowInfo* info, int x0, int y0, int x1, int y1, int dx, int dy)
+{
+    int scale = info->draw_scale;
+    int pitch = info->ximage->bytes_per_line;
+    int bpp = s_bytes_per_pixel;
+    int row_size = (x1 - x0) * scale * bpp;
+    int offset = (dy * scale * pitch) + (dx * scale * bpp);
+    int y, step;
+
+    // Walk the rows away from the direction of the move so the source rows aren't overwritten before being read
+    y = dy > 0 ? (y1 * scale) - 1 : y0 * scale;
+    step = dy > 0 ? -1 : 1;
+
+    for (; y >= y0 * scale && y < y1 * scale; y += step) {
+        char* dest = (char*)info->draw_buffer + (y * pitch) + (x0 * scale * bpp);
+        memmove(dest, dest - offset, row_size);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scrolls the contents of a region of the window by dx, dy (in buffer pixels) and uploads only the part of the
+// region that was scrolled in. The buffer is expected to already hold the scrolled contents and everything outside
+// of the region is expected to be unchanged since the last update.
+
+void mfb_scroll_region(void* window_info, void* buffer, int stride, int dx, int dy, int x, int y, int width, int height)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    int scale = info->draw_scale;
+    int strips[2][4];
+    int strip_count = 0;
+    int bytes_per_line;
+    int mx0, my0, mx1, my1, i;
+    Drawable target;
+
+    if (stride <= 0)
+        stride = info->input_width;
+
+    // Without a previous frame on the screen there is nothing to move. The scrolled region isn't a rectangle of the
+    // window when it's rotated or flipped and the post effects depend on the position and neighbours of the pixels so
+    // in both cases it's updated in full.
+    if (!info->has_frame || !info->update || !buffer || info->orientation || info->effect_buffer || info->shared_frame) {
+        mfb_update_with_buffer_stride(window_info, buffer, stride);
+        return;
     }
 
-    return 0;
+    bytes_per_line = info->ximage->bytes_per_line;
+    info->indexed_frame = 0;
+
+    if (dx <= -width || dx >= width || dy <= -height || dy >= height)
+        dx = dy = 0, mx0 = mx1 = x, my0 = my1 = y;
+    else {
+        mx0 = x + (dx > 0 ? dx : 0);
+        mx1 = x + width + (dx < 0 ? dx : 0);
+        my0 = y + (dy > 0 ? dy : 0);
+        my1 = y + height + (dy < 0 ? dy : 0);
+    }
+
+    // Everything in the region outside of the moved rectangle is new: full rows above or below it and
+    // a column to the left or right of it
+
+    if (my0 > y || mx0 == mx1) {
+        strips[strip_count][0] = x; strips[strip_count][1] = y;
+        strips[strip_count][2] = x + width; strips[strip_count][3] = mx0 == mx1 ? y + height : my0;
+        strip_count++;
+    } else if (my1 < y + height) {
+        strips[strip_count][0] = x; strips[strip_count][1] = my1;
+        strips[strip_count][2] = x + width; strips[strip_count][3] = y + height;
+        strip_count++;
+    }
+
+    if (mx0 != mx1 && (mx0 > x || mx1 < x + width)) {
+        strips[strip_count][0] = mx0 > x ? x : mx1; strips[strip_count][1] = my0;
+        strips[strip_count][2] = mx0 > x ? mx0 : x + width; strips[strip_count][3] = my1;
+        strip_count++;
+    }
+
+    if (info->prev_buffer) {
+        for (i = y; i < y + height; ++i) {
+            memcpy(info->prev_buffer + (i * info->buffer_width) + x, 
+                   (const uint32_t*)buffer + (i * stride) + x, width * 4);
+        }
+    }
+
+    // The draw buffer is only used to repaint the window when there is no copy of it on the server
+    if (!info->pixmap && !info->band_rows && mx0 != mx1)
+        move_draw_buffer(info, mx0, my0, mx1, my1, dx, dy);
+
+    // In banded mode the strips are scaled while uploading
+    if (!info->draw_buffer) {
+        info->ximage->data = (char*)buffer;
+        info->ximage->bytes_per_line = stride * 4;
+    } else if (!info->band_rows) {
+        for (i = 0; i < strip_count; ++i)
+            scale_rect(info, (const uint32_t*)buffer, stride, strips[i][0], strips[i][1], strips[i][2], strips[i][3],
+                       strips[i][1]);
+    }
+
+    target = info->pixmap ? info->pixmap : info->window;
+
+    if (mx0 != mx1) {
+        // When copying within the window parts of it may be obscured and those are repainted on GraphicsExpose
+        if (!info->pixmap)
+            XSetGraphicsExposures(s_display, s_gc, True);
+
+        XCopyArea(s_display, target, target, s_gc, 
+                  (mx0 - dx) * scale, (my0 - dy) * scale, (mx1 - mx0) * scale, (my1 - my0) * scale,
+                  mx0 * scale, my0 * scale);
+
+        if (!info->pixmap)
+            XSetGraphicsExposures(s_display, s_gc, False);
+    }
+
+    for (i = 0; i < strip_count; ++i) {
+        if (info->band_rows) {
+            put_banded(info, (const uint32_t*)buffer, stride, strips[i][0], strips[i][1], strips[i][2], strips[i][3],
+                       target);
+        } else {
+            XPutImage(s_display, target, s_gc, info->ximage, 
+                      strips[i][0] * scale, strips[i][1] * scale, strips[i][0] * scale, strips[i][1] * scale,
+                      (strips[i][2] - strips[i][0]) * scale, (strips[i][3] - strips[i][1]) * scale);
+        }
+    }
+
+    if (!info->draw_buffer) {
+        info->ximage->data = NULL;
+        info->ximage->bytes_per_line = bytes_per_line;
+    }
+
+    if (info->src_picture) {
+        XRenderComposite(s_display, PictOpSrc, info->src_picture, None, info->window_picture,
+                         x * info->scale, y * info->scale, 0, 0, x * info->scale, y * info->scale,
+                         width * info->scale, height * info->scale);
+    } else if (info->pixmap) {
+        XCopyArea(s_display, info->pixmap, info->window, s_gc, x * scale, y * scale, 
+                  width * scale, height * scale, x * scale, y * scale);
+    }
+
+    XFlush(s_display);
+    stamp_latency(info);
+
+    clear_frame_input(info);
+
+    process_events();
+
+    update_pointer(info);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Uploads buffers for several windows that has been prepared with mfb_prepare_buffer. There is a single flush and 
+// event processing for all of them and the mouse positions are taken from motion events instead of one
+// XQueryPointer round-trip per window.
 
-static void scale_2x(unsigned int* dest, unsigned int* source, int width, int height, int scale) {
-    int x, y;
-    for (y = 0; y < height; y += scale) {
-        for (x = 0; x < width; x += scale) {
-            const unsigned int t = *source++;
-            dest[0] = t;
-            dest[1] = t;
-            dest[width + 0] = t;
-            dest[width + 1] = t;
-            dest += scale;
-        }
+void mfb_update_prepared(void** windows, int count)
+{
+    int i;
+
+    for (i = 0; i < count; ++i)
+        put_prepared((WindowInfo*)windows[i]);
+
+    XFlush(s_display);
+
+    for (i = 0; i < count; ++i) {
+        WindowInfo* info = (WindowInfo*)windows[i];
 
-        dest += width * (scale - 1);
+        // A window without new output has nothing to measure, stamping it would only cost a round trip
+        if (info->pending_buffer)
+            stamp_latency(info);
+
+        clear_prepared(info);
+        clear_frame_input(info);
     }
+
+    process_events();
+
+    for (i = 0; i < count; ++i)
+        flush_raw_motion((WindowInfo*)windows[i]);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scales and uploads the rectangle of the buffer as soon as it has been rendered so the upload overlaps with rendering
+// the rest of the frame. mfb_finish_tiles ends the frame. Returns 0 if the window can't be updated a rectangle at a
+// time (it's rotated/flipped or edge blending mixes in pixels that may not be rendered yet), the caller then
+// presents the full buffer instead.
 
-static void scale_4x(unsigned int* dest, unsigned int* source, int width, int height, int scale) {
-    int x, y;
-    for (y = 0; y < height; y += scale) {
-        for (x = 0; x < width; x += scale) {
-            const unsigned int t = *source++;
-            dest[(width * 0) + 0] = t;
-            dest[(width * 0) + 1] = t;
-            dest[(width * 0) + 2] = t;
-            dest[(width * 0) + 3] = t;
-            dest[(width * 1) + 0] = t;
-            dest[(width * 1) + 1] = t;
-            dest[(width * 1) + 2] = t;
-            dest[(width * 1) + 3] = t;
-            dest[(width * 2) + 0] = t;
-            dest[(width * 2) + 1] = t;
-            dest[(width * 2) + 2] = t;
-            dest[(width * 2) + 3] = t;
-            dest[(width * 3) + 0] = t;
-            dest[(width * 3) + 1] = t;
-            dest[(width * 3) + 2] = t;
-            dest[(width * 3) + 3] = t;
-            dest += scale;
+int mfb_update_tile(void* window_info, void* buffer, int x, int y, int width, int height)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    int stride = info->input_width;
+    int scale = info->draw_scale;
+    int bytes_per_line;
+    Drawable target = info->pixmap ? info->pixmap : info->window;
+    int i;
+
+    if (info->orientation || info->effect_edge_blend)
+        return 0;
+
+    if (!info->update)
+        return 1;
+
+    bytes_per_line = info->ximage->bytes_per_line;
+
+    if (info->prev_buffer) {
+        for (i = y; i < y + height; ++i) {
+            memcpy(info->prev_buffer + (i * stride) + x, (const uint32_t*)buffer + (i * stride) + x, width * 4);
         }
+    }
 
-        dest += width * (scale - 1);
-    }
-}
-
-
-#define write_8(offset) \
-    dest[(width * offset) + 0] = t; \
-    dest[(width * offset) + 1] = t; \
-    dest[(width * offset) + 2] = t; \
-    dest[(width * offset) + 3] = t; \
-    dest[(width * offset) + 4] = t; \
-    dest[(width * offset) + 5] = t; \
-    dest[(width * offset) + 6] = t; \
-    dest[(width * offset) + 7] = t;
-
-#define write_16(offset) \
-    dest[(width * offset) + 0] = t; \
-    dest[(width * offset) + 1] = t; \
-    dest[(width * offset) + 2] = t; \
-    dest[(width * offset) + 3] = t; \
-    dest[(width * offset) + 4] = t; \
-    dest[(width * offset) + 5] = t; \
-    dest[(width * offset) + 6] = t; \
-    dest[(width * offset) + 7] = t; \
-    dest[(width * offset) + 8] = t; \
-    dest[(width * offset) + 9] = t; \
-    dest[(width * offset) + 10] = t; \
-    dest[(width * offset) + 11] = t; \
-    dest[(width * offset) + 12] = t; \
-    dest[(width * offset) + 13] = t; \
-    dest[(width * offset) + 14] = t; \
-    dest[(width * offset) + 15] = t;
-
-#define write_32(offset) \
-    dest[(width * offset) + 0] = t; \
-    dest[(width * offset) + 1] = t; \
-    dest[(width * offset) + 2] = t; \
-    dest[(width * offset) + 3] = t; \
-    dest[(width * offset) + 4] = t; \
-    dest[(width * offset) + 5] = t; \
-    dest[(width * offset) + 6] = t; \
-    dest[(width * offset) + 7] = t; \
-    dest[(width * offset) + 8] = t; \
-    dest[(width * offset) + 9] = t; \
-    dest[(width * offset) + 10] = t; \
-    dest[(width * offset) + 11] = t; \
-    dest[(width * offset) + 12] = t; \
-    dest[(width * offset) + 13] = t; \
-    dest[(width * offset) + 14] = t; \
-    dest[(width * offset) + 15] = t; \
-    dest[(width * offset) + 16] = t; \
-    dest[(width * offset) + 17] = t; \
-    dest[(width * offset) + 18] = t; \
-    dest[(width * offset) + 19] = t; \
-    dest[(width * offset) + 20] = t; \
-    dest[(width * offset) + 21] = t; \
-    dest[(width * offset) + 22] = t; \
-    dest[(width * offset) + 23] = t; \
-    dest[(width * offset) + 24] = t; \
-    dest[(width * offset) + 25] = t; \
-    dest[(width * offset) + 26] = t; \
-    dest[(width * offset) + 27] = t; \
-    dest[(width * offset) + 28] = t; \
-    dest[(width * offset) + 29] = t; \
-    dest[(width * offset) + 30] = t; \
-    dest[(width * offset) + 31] = t;
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void scale_8x(unsigned int* dest, unsigned int* source, int width, int height, int scale) {
-    int x, y;
-    scale = 8;
-    for (y = 0; y < height; y += 8) {
-        for (x = 0; x < width; x += 8) {
-            const unsigned int t = *source++;
-
-            write_8(0);
-            write_8(1);
-            write_8(2);
-            write_8(3);
-            write_8(4);
-            write_8(5);
-            write_8(6);
-            write_8(7);
+    if (info->band_rows) {
+        put_banded(info, (const uint32_t*)buffer, stride, x, y, x + width, y + height, target);
+    } else {
+        if (info->draw_buffer) {
+            scale_rect(info, (const uint32_t*)buffer, stride, x, y, x + width, y + height, y);
+        } else {
+            info->ximage->data = (char*)buffer;
+            info->ximage->bytes_per_line = stride * 4;
+        }
 
-            dest += scale;
+        XPutImage(s_display, target, s_gc, info->ximage, x * scale, y * scale, x * scale, y * scale, 
+                  width * scale, height * scale);
+
+        if (!info->draw_buffer) {
+            info->ximage->data = NULL;
+            info->ximage->bytes_per_line = bytes_per_line;
         }
+    }
+
+    if (info->src_picture) {
+        XRenderComposite(s_display, PictOpSrc, info->src_picture, None, info->window_picture,
+                         x * info->scale, y * info->scale, 0, 0, x * info->scale, y * info->scale,
+                         width * info->scale, height * info->scale);
+    } else if (info->pixmap) {
+        XCopyArea(s_display, info->pixmap, info->window, s_gc, x * scale, y * scale, 
+                  width * scale, height * scale, x * scale, y * scale);
+    }
 
-        dest += width * (scale - 1);
+    // Flushing each tile costs a write to the socket for small tiles, so they're gathered until enough is queued for
+    // the server to work on while the rest is rendered
+    info->tile_bytes += width * height * scale * scale * s_bytes_per_pixel;
+
+    if (info->tile_bytes >= TILE_FLUSH_SIZE) {
+        XFlush(s_display);
+        info->tile_bytes = 0;
     }
+
+    return 1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void scale_16x(unsigned int* dest, unsigned int* source, int width, int height, int scale) {
-    int x, y;
-    scale = 16;
-    for (y = 0; y < height; y += scale) {
-        for (x = 0; x < width; x += scale) {
-            const unsigned int t = *source++;
-
-            write_16(0);
-            write_16(1);
-            write_16(2);
-            write_16(3);
-            write_16(4);
-            write_16(5);
-            write_16(6);
-            write_16(7);
-            write_16(8);
-            write_16(9);
-            write_16(10);
-            write_16(11);
-            write_16(12);
-            write_16(13);
-            write_16(14);
-            write_16(15);
+void mfb_finish_tiles(void* window_info)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
 
-            dest += scale;
+    if (info->update) {
+        info->has_frame = 1;
+        info->shared_frame = 0;
+        info->indexed_frame = 0;
+    }
+
+    XFlush(s_display);
+    info->tile_bytes = 0;
+
+    stamp_latency(info);
+
+    clear_frame_input(info);
+
+    process_events();
+
+    if (info->update)
+        update_pointer(info);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shows the same buffer in several windows. The buffer is only scaled once for each distinct image (size, scale
+// and orientation), the other windows upload the image of the first window that has it. The uploads, flush and
+// event processing are batched as in mfb_update_prepared.
+
+void mfb_update_mirrored(void** windows, int count, void* buffer)
+{
+    int i, j;
+
+    for (i = 0; i < count; ++i) {
+        WindowInfo* info = (WindowInfo*)windows[i];
+        WindowInfo* owner = 0;
+        int y0, y1;
+
+        for (j = 0; j < i && !owner; ++j) {
+            WindowInfo* other = (WindowInfo*)windows[j];
+
+            if (other->update && other->has_frame && !other->shared_frame && same_image(other, info))
+                owner = other;
         }
 
-        dest += width * (scale - 1);
+        if (!owner) {
+            mfb_prepare_buffer(info, buffer, 0);
+            continue;
+        }
+
+        info->pending_buffer = 0;
+
+        if (!info->update || !find_pending_rows(info, (const uint32_t*)buffer, info->input_width, &y0, &y1))
+            continue;
+
+        info->pending_buffer = buffer;
+        info->pending_image = owner->ximage;
+        info->pending_stride = info->input_width;
+        info->pending_y0 = y0;
+        info->pending_y1 = y1;
+        info->has_frame = 1;
+        info->shared_frame = owner->window;
+        info->indexed_frame = 0;
     }
+
+    mfb_update_prepared(windows, count);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The color transform needs a draw buffer to write to, so windows that upload directly from the input buffer
+// switch to using one
 
-void scale_32x(unsigned int* dest, unsigned int* source, int width, int height, int scale) {
-    int x, y;
+static int enable_color_transform(WindowInfo* info)
+{
+    if (!info->color_buffer)
+        info->color_buffer = (uint32_t*)malloc(info->buffer_width * 4);
 
-    for (y = 0; y < scale; y += scale) {
-        for (x = 0; x < width; x += scale) {
-            const unsigned int t = *source++;
-
-            write_32(0);
-            write_32(1);
-            write_32(2);
-            write_32(3);
-            write_32(4);
-            write_32(5);
-            write_32(6);
-            write_32(7);
-            write_32(8);
-            write_32(9);
-            write_32(10);
-            write_32(11);
-            write_32(12);
-            write_32(13);
-            write_32(14);
-            write_32(15);
-
-            write_32(16);
-            write_32(17);
-            write_32(18);
-            write_32(19);
-            write_32(20);
-            write_32(21);
-            write_32(22);
-            write_32(23);
-            write_32(24);
-            write_32(25);
-            write_32(26);
-            write_32(27);
-            write_32(28);
-            write_32(29);
-            write_32(30);
-            write_32(31);
+    // Everything has to be redrawn with the new transform
+    info->has_frame = 0;
 
-            dest += scale;
+    return ensure_draw_buffer(info) && info->color_buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets per channel curves (256 entries each for red, green and blue) or disables them if curves is NULL
+
+int mfb_set_color_curves(void* window_info, const uint8_t* curves)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+
+    if (!info->ximage)
+        return 0;
+
+    free(info->color_curves);
+    info->color_curves = 0;
+    info->has_frame = 0;
+
+    if (curves) {
+        if (!enable_color_transform(info))
+            return 0;
+
+        info->color_curves = (uint8_t*)malloc(256 * 3);
+
+        if (!info->color_curves) {
+            printf("Unable to allocate the color curves\n");
+            return 0;
         }
 
-        dest += width * (scale - 1);
+        memcpy(info->color_curves, curves, 256 * 3);
     }
+
+    return 1;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets a 3D lut of size^3 entries or disables it if lut is NULL
 
-void mfb_update_with_buffer(void* window_info, void* buffer)
+int mfb_set_color_lut(void* window_info, const uint32_t* lut, int size)
 {
     WindowInfo* info = (WindowInfo*)window_info;
-    int width = info->width;
-    int height = info->height;
-    int scale = info->scale;
 
-    if (info->update && buffer) {
-        switch (scale) {
-            case 1: {
-                memcpy(info->draw_buffer, buffer, width * height * 4);
-                break;
-            }
-            case 2: {
-                scale_2x(info->draw_buffer, buffer, width, height, scale); 
-                break;
-            }
+    if (!info->ximage)
+        return 0;
 
-            case 4: {
-                scale_4x(info->draw_buffer, buffer, width, height, scale); 
-                break;
-            }
+    free(info->color_lut);
+    info->color_lut = 0;
+    info->has_frame = 0;
 
-            case 8: {
-                scale_8x(info->draw_buffer, buffer, width, height, scale); 
-                break;
-            }
+    if (lut) {
+        if (!enable_color_transform(info))
+            return 0;
 
-            case 16: {
-                scale_16x(info->draw_buffer, buffer, width, height, scale); 
-                break;
-            }
+        info->color_lut = (uint32_t*)malloc((size_t)size * size * size * 4);
 
-            case 32: {
-                scale_32x(info->draw_buffer, buffer, width, height, scale); 
-                break;
+        if (!info->color_lut) {
+            printf("Unable to allocate a color lut of %d^3 entries\n", size);
+            return 0;
+        }
+
+        info->color_lut_size = size;
+        memcpy(info->color_lut, lut, (size_t)size * size * size * 4);
+    }
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sets the post effects (scanlines and shadow_mask strength 0 - 255, edge_blend 0 or 1). They're applied while scaling
+// on the client so they're ignored with a scale of 1 or server side scaling.
+
+void mfb_set_post_effects(void* window_info, int scanlines, int shadow_mask, int edge_blend)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    int kind, x, c;
+
+    if (!info->ximage)
+        return;
+
+    free(info->effect_buffer);
+    info->effect_buffer = 0;
+    info->effect_scanlines = scanlines;
+    info->effect_mask = shadow_mask;
+    info->effect_edge_blend = edge_blend;
+    info->has_frame = 0;
+
+    if ((!scanlines && !shadow_mask && !edge_blend) || info->draw_scale == 1 || !info->draw_buffer)
+        return;
+
+    for (kind = 0; kind < 2; ++kind) {
+        int scan = kind ? 256 - scanlines : 256;
+
+        for (x = 0; x < EFFECT_COLUMNS; ++x) {
+            // Columns are red, green and blue in that order and the channels are stored blue first
+            for (c = 0; c < 3; ++c) {
+                int mask = (2 - c) == (x % 3) ? 256 : 256 - shadow_mask;
+                info->effect_factors[kind][x][c] = (uint16_t)((mask * scan) >> 8);
             }
+
+            info->effect_factors[kind][x][3] = 256;
         }
+    }
 
-        XPutImage(s_display, info->window, s_gc, info->ximage, 0, 0, 0, 0, width, height);
-        XFlush(s_display);
+    // Previous row, two scaled rows (plain and blended) and the output row for converted formats
+    info->effect_buffer = (uint32_t*)malloc((info->buffer_width + 1 + (info->buffer_width * info->draw_scale * 3)) * 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Starts or stops measuring the latency from input events to the next frame. Stopping drops the histogram.
+
+void mfb_set_latency_tracking(void* window_info, int enable)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+
+    if (!info->ximage)
+        return;
+
+    info->latency_input = 0;
+
+    if (enable && !info->latency_histogram) {
+        if (!s_latency_atom)
+            s_latency_atom = XInternAtom(s_display, "_MINIFB_LATENCY", False);
+
+        info->latency_histogram = (uint32_t*)calloc(LATENCY_BUCKETS, sizeof(uint32_t));
+        XSelectInput(s_display, info->window, WINDOW_EVENT_MASK | PropertyChangeMask);
+    } else if (!enable && info->latency_histogram) {
+        free(info->latency_histogram);
+        info->latency_histogram = 0;
+        XSelectInput(s_display, info->window, WINDOW_EVENT_MASK);
     }
+}
 
-    // clear before processing new events
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Copies up to count buckets of the latency histogram. Returns the number of buckets copied or 0 if the latency
+// isn't tracked.
 
-    if (info->shared_data) {
-        info->shared_data->scroll_x = 0.0f;
-        info->shared_data->scroll_y = 0.0f;
+int mfb_get_latency_histogram(void* window_info, uint32_t* buckets, int count)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+
+    if (!info->ximage || !info->latency_histogram)
+        return 0;
+
+    count = min_int(count, LATENCY_BUCKETS);
+    memcpy(buckets, info->latency_histogram, count * sizeof(uint32_t));
+
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void select_xinput2(WindowInfo* info, int enable)
+{
+    unsigned char bits[XIMaskLen(XI_LASTEVENT)] = { 0 };
+    XIEventMask mask;
+
+    mask.deviceid = XIAllMasterDevices;
+    mask.mask_len = sizeof(bits);
+    mask.mask = bits;
+
+    // Selecting the XInput2 pointer events replaces the core pointer events for the window
+    if (enable) {
+        XISetMask(bits, XI_Motion);
+        XISetMask(bits, XI_ButtonPress);
+        XISetMask(bits, XI_ButtonRelease);
+        XISetMask(bits, XI_Enter);
+        XISetMask(bits, XI_Leave);
+        XISetMask(bits, XI_DeviceChanged);
     }
 
-    get_mouse_pos(info);
-    process_events();
+    XISelectEvents(s_display, info->window, &mask, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Switches the pointer input of the window to XInput2 for sub-pixel positions, smooth scrolling and the history of the
+// pointer motion between updates. Returns 0 if XInput 2.1 isn't supported.
+
+int mfb_set_precise_pointer(void* window_info, int enable)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    Window root, child;
+    int root_x, root_y, x, y;
+    unsigned int mask;
+
+    if (!info->ximage || (enable && !has_xinput2()))
+        return 0;
+
+    info->pointer_count = 0;
+    info->raw_x = 0.0f;
+    info->raw_y = 0.0f;
+
+    if (enable && !info->pointer_history) {
+        // Raw motion is only sent to the root window
+        if (!s_raw_motion) {
+            unsigned char bits[XIMaskLen(XI_RawMotion)] = { 0 };
+            XIEventMask raw_mask;
+
+            raw_mask.deviceid = XIAllMasterDevices;
+            raw_mask.mask_len = sizeof(bits);
+            raw_mask.mask = bits;
+            XISetMask(bits, XI_RawMotion);
+
+            XISelectEvents(s_display, DefaultRootWindow(s_display), &raw_mask, 1);
+            load_scroll_axes();
+            s_raw_motion = 1;
+        }
+
+        info->pointer_history = (PointerSample*)malloc(POINTER_HISTORY * sizeof(PointerSample));
+        select_xinput2(info, 1);
+
+        // There is no enter event if the pointer already is in the window
+        if (XQueryPointer(s_display, info->window, &root, &child, &root_x, &root_y, &x, &y, &mask) &&
+            x >= 0 && y >= 0 && x < info->width && y < info->height)
+            s_pointer_info = info;
+    } else if (!enable && info->pointer_history) {
+        select_xinput2(info, 0);
+        free(info->pointer_history);
+        info->pointer_history = 0;
+
+        if (s_pointer_info == info)
+            s_pointer_info = 0;
+    }
+
+    return 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Returns the pointer samples since the last update
+
+const PointerSample* mfb_get_pointer_history(void* window_info, int* count)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+
+    if (!info->ximage || !info->pointer_history) {
+        *count = 0;
+        return 0;
+    }
+
+    *count = info->pointer_count;
+
+    return info->pointer_history;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -750,12 +3316,44 @@ void mfb_update(void* window_info, void* buffer)
     mfb_update_with_buffer(window_info, 0);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File descriptor of the X connection so the application can wait for input in its own event loop
+
+int mfb_get_connection_fd()
+{
+    return ConnectionNumber(s_display);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Processes the events that can be read from the connection without blocking. Unlike the update functions this
+// doesn't present anything or query the server, so the connection fd only becomes readable again on new input.
+
+void mfb_dispatch_pending(void* window_info)
+{
+    WindowInfo* info = (WindowInfo*)window_info;
+    XEvent event;
+
+    clear_frame_input(info);
+
+    while (XEventsQueued(s_display, QueuedAfterReading) > 0) {
+        XNextEvent(s_display, &event);
+
+        if (process_event(&event) == 0)
+            break;
+    }
+
+    flush_raw_motion(info);
+
+    // Make sure nothing is left in the output buffer before the application goes back to waiting
+    XFlush(s_display);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void mfb_set_position(void* window, int x, int y) 
 {
     WindowInfo* info = (WindowInfo*)window;
-    XMoveWindow(s_display, info->window, x, y);
+    XMoveWindow(s_display, info->frame, x, y);
     XFlush(s_display);
 }
 
@@ -765,18 +3363,62 @@ void mfb_close(void* window_info)
 {
     WindowInfo* info = (WindowInfo*)window_info;
 
-    if (!info->draw_buffer)
+    if (!info->ximage)
         return;
 
     XSaveContext(s_display, info->window, s_context, (XPointer)0);
+    XSaveContext(s_display, info->frame, s_context, (XPointer)0);
+
+    if (s_pointer_info == info)
+        s_pointer_info = 0;
+
+    if (info->image_cursor)
+        XFreeCursor(s_display, info->image_cursor);
+
+    if (info->src_picture) {
+        XRenderFreePicture(s_display, info->src_picture);
+        XRenderFreePicture(s_display, info->window_picture);
+    }
 
+    if (info->pixmap)
+        XFreePixmap(s_display, info->pixmap);
+
+    free(info->prev_buffer);
+    free(info->line_buffer);
+    free(info->color_curves);
+    free(info->color_lut);
+    free(info->color_buffer);
+    free(info->orient_buffer);
+    free(info->input_row);
+    free(info->input_buffer);
+    free(info->indices);
+    free(info->effect_buffer);
+    free(info->latency_histogram);
+    free(info->pointer_history);
     free(info->draw_buffer);
 
-    info->ximage->data = NULL;
+    // The setters and updates can still be called after the window manager closed the window
+    info->prev_buffer = 0;
+    info->line_buffer = 0;
+    info->color_curves = 0;
+    info->color_lut = 0;
+    info->color_buffer = 0;
+    info->orient_buffer = 0;
+    info->input_row = 0;
+    info->input_buffer = 0;
+    info->indices = 0;
+    info->effect_buffer = 0;
+    info->latency_histogram = 0;
+    info->pointer_history = 0;
+    info->pointer_count = 0;
     info->draw_buffer = 0;
 
+    info->ximage->data = NULL;
+
     XDestroyImage(info->ximage);
-    XDestroyWindow(s_display, info->window);
+    XDestroyWindow(s_display, info->frame);
+
+    info->ximage = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -798,8 +3440,8 @@ void mfb_set_shared_data(void* window, SharedData* data)
 {
     WindowInfo* win = (WindowInfo*)window;
     win->shared_data = data;
-    win->shared_data->width = win->width;
-    win->shared_data->height = win->height;
+    win->shared_data->width = win->input_width * win->scale;
+    win->shared_data->height = win->input_height * win->scale;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -810,10 +3452,17 @@ int mfb_should_close(void* window) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Size of the monitor the pointer is on (the screen with a single monitor)
 
 unsigned int mfb_get_screen_size() {
-    setup_display();
-    return (s_screen_width << 16) | s_screen_height;
+    int x, y, width, height;
+
+    if (!setup_display())
+        return 0;
+
+    get_monitor_rect(&x, &y, &width, &height);
+
+    return (width << 16) | height;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,123 @@
+#![cfg(any(target_os="linux",
+    target_os="freebsd",
+    target_os="dragonfly",
+    target_os="netbsd",
+    target_os="openbsd"))]
+
+extern crate x11_dl;
+
+use self::x11_dl::keysym::*;
+use Key;
+
+//
+// Maps X11 keysyms to keys. Used by the X11 backend and the RFB server (where key events also are sent as keysyms)
+//
+#[allow(non_upper_case_globals)]
+pub fn to_key(keysym: u32) -> Option<Key> {
+    let key = match keysym {
+        XK_0 => Key::Key0,
+        XK_1 => Key::Key1,
+        XK_2 => Key::Key2,
+        XK_3 => Key::Key3,
+        XK_4 => Key::Key4,
+        XK_5 => Key::Key5,
+        XK_6 => Key::Key6,
+        XK_7 => Key::Key7,
+        XK_8 => Key::Key8,
+        XK_9 => Key::Key9,
+        XK_a => Key::A,
+        XK_b => Key::B,
+        XK_c => Key::C,
+        XK_d => Key::D,
+        XK_e => Key::E,
+        XK_f => Key::F,
+        XK_g => Key::G,
+        XK_h => Key::H,
+        XK_i => Key::I,
+        XK_j => Key::J,
+        XK_k => Key::K,
+        XK_l => Key::L,
+        XK_m => Key::M,
+        XK_n => Key::N,
+        XK_o => Key::O,
+        XK_p => Key::P,
+        XK_q => Key::Q,
+        XK_r => Key::R,
+        XK_s => Key::S,
+        XK_t => Key::T,
+        XK_u => Key::U,
+        XK_v => Key::V,
+        XK_w => Key::W,
+        XK_x => Key::X,
+        XK_y => Key::Y,
+        XK_z => Key::Z,
+        XK_F1 => Key::F1,
+        XK_F2 => Key::F2,
+        XK_F3 => Key::F3,
+        XK_F4 => Key::F4,
+        XK_F5 => Key::F5,
+        XK_F6 => Key::F6,
+        XK_F7 => Key::F7,
+        XK_F8 => Key::F8,
+        XK_F9 => Key::F9,
+        XK_F10 => Key::F10,
+        XK_F11 => Key::F11,
+        XK_F12 => Key::F12,
+        XK_Down => Key::Down,
+        XK_Left => Key::Left,
+        XK_Right => Key::Right,
+        XK_Up => Key::Up,
+        XK_Escape => Key::Escape,
+        XK_apostrophe => Key::Apostrophe,
+        XK_grave => Key::Backquote,
+        XK_backslash => Key::Backslash,
+        XK_comma => Key::Comma,
+        XK_equal => Key::Equal,
+        XK_bracketleft => Key::LeftBracket,
+        XK_minus => Key::Minus,
+        XK_period => Key::Period,
+        XK_braceright => Key::RightBracket,
+        XK_semicolon => Key::Semicolon,
+        XK_slash => Key::Slash,
+        XK_BackSpace => Key::Backspace,
+        XK_Delete => Key::Delete,
+        XK_End => Key::End,
+        XK_Return => Key::Enter,
+        XK_Home => Key::Home,
+        XK_Insert => Key::Insert,
+        XK_Menu => Key::Menu,
+        XK_Page_Down => Key::PageDown,
+        XK_Page_Up => Key::PageUp,
+        XK_Pause => Key::Pause,
+        XK_space => Key::Space,
+        XK_Tab => Key::Tab,
+        XK_Num_Lock => Key::NumLock,
+        XK_Caps_Lock => Key::CapsLock,
+        XK_Scroll_Lock => Key::ScrollLock,
+        XK_Shift_L => Key::LeftShift,
+        XK_Shift_R => Key::RightShift,
+        XK_Control_L => Key::LeftCtrl,
+        XK_Control_R => Key::RightCtrl,
+        XK_KP_0 => Key::NumPad0,
+        XK_KP_1 => Key::NumPad1,
+        XK_KP_2 => Key::NumPad2,
+        XK_KP_3 => Key::NumPad3,
+        XK_KP_4 => Key::NumPad4,
+        XK_KP_5 => Key::NumPad5,
+        XK_KP_6 => Key::NumPad6,
+        XK_KP_7 => Key::NumPad7,
+        XK_KP_8 => Key::NumPad8,
+        XK_KP_9 => Key::NumPad9,
+        XK_KP_Decimal => Key::NumPadDot,
+        XK_KP_Divide => Key::NumPadSlash,
+        XK_KP_Multiply => Key::NumPadAsterisk,
+        XK_KP_Subtract => Key::NumPadMinus,
+        XK_KP_Add => Key::NumPadPlus,
+        XK_KP_Enter => Key::NumPadEnter,
+        XK_Super_L => Key::LeftSuper,
+        XK_Super_R => Key::RightSuper,
+        _ => return None,
+    };
+
+    Some(key)
+}
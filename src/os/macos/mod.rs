@@ -1,6 +1,6 @@
 #![cfg(target_os = "macos")]
 
-use {MouseButton, MouseMode, Scale, Key, KeyRepeat, WindowOptions};
+use {MouseButton, MouseMode, Scale, Key, KeyRepeat, WindowOptions, PostEffects, LatencyHistogram, PointerSample, YuvFrame};
 use key_handler::KeyHandler;
 use error::Error;
 use Result;
@@ -208,6 +208,7 @@ pub struct Window {
     scale_factor: usize,
     pub shared_data: SharedData,
     key_handler: KeyHandler,
+    indexed: buffer_helper::IndexedFrame,
     pub has_set_data: bool,
     menus: Vec<MenuHandle>,
 }
@@ -268,6 +269,7 @@ impl Window {
                     ..SharedData::default()
                 },
                 key_handler: KeyHandler::new(),
+                indexed: buffer_helper::IndexedFrame::new(),
                 has_set_data: false,
                 menus: Vec::new(),
             })
@@ -315,6 +317,92 @@ impl Window {
         Ok(())
     }
 
+    pub fn update_with_buffer_stride(&mut self, buffer: &[u32], x: usize, y: usize, stride: usize) -> Result<()> {
+        let check_res = buffer_helper::check_buffer_stride(self.shared_data.width as usize,
+                                                           self.shared_data.height as usize,
+                                                           self.scale_factor as usize,
+                                                           x, y, stride, buffer);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_buffer_stride(self.shared_data.width as usize,
+                                                       self.shared_data.height as usize,
+                                                       self.scale_factor as usize,
+                                                       x, y, stride, buffer);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_yuv(&mut self, frame: &YuvFrame) -> Result<()> {
+        let check_res = buffer_helper::check_yuv_frame(self.shared_data.width as usize,
+                                                       self.shared_data.height as usize,
+                                                       self.scale_factor as usize,
+                                                       frame);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_yuv_frame(self.shared_data.width as usize,
+                                                   self.shared_data.height as usize,
+                                                   self.scale_factor as usize,
+                                                   frame);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        self.indexed.set_palette(palette)
+    }
+
+    pub fn update_with_indexed(&mut self, indices: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_indexed_buffer(self.shared_data.width as usize,
+                                                            self.shared_data.height as usize,
+                                                            self.scale_factor as usize,
+                                                            indices);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = self.indexed.expand(self.shared_data.width as usize,
+                                         self.shared_data.height as usize,
+                                         self.scale_factor as usize,
+                                         indices);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let check_res = self.indexed.set_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        match self.indexed.expand_cached() {
+            Some(packed) => self.update_with_buffer(&packed),
+            None => Err(buffer_helper::no_indexed_frame()),
+        }
+    }
+
+    pub fn scroll_region(&mut self, buffer: &[u32], _dx: isize, _dy: isize,
+                         x: usize, y: usize, width: usize, height: usize) -> Result<()> {
+        let check_res = buffer_helper::check_region(self.shared_data.width as usize,
+                                                    self.shared_data.height as usize,
+                                                    self.scale_factor as usize,
+                                                    x, y, width, height);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        // The buffer already holds the scrolled contents so a full update shows the same result
+        self.update_with_buffer(buffer)
+    }
+
+    pub fn update_tile(&mut self, _frame: *const u32, _x: usize, _y: usize, _width: usize, _height: usize) -> bool {
+        // The caller presents the finished frame as a whole
+        false
+    }
+
+    pub fn finish_tiles(&mut self) {
+    }
+
     pub fn update(&mut self) {
         self.key_handler.update();
 
@@ -349,6 +437,14 @@ impl Window {
         }
     }
 
+    pub fn set_precise_pointer(&mut self, _enable: bool) -> bool {
+        false
+    }
+
+    pub fn get_pointer_history(&self) -> &[PointerSample] {
+        &[]
+    }
+
     pub fn get_mouse_down(&self, button: MouseButton) -> bool {
         match button {
             MouseButton::Left => self.shared_data.state[0] > 0,
@@ -390,6 +486,47 @@ impl Window {
         }
     }
 
+    pub fn set_cursor_image(&mut self, image: &[u32], width: usize, height: usize,
+                            hot_x: usize, hot_y: usize) -> Result<()> {
+        let check_res = buffer_helper::check_cursor_image(width, height, hot_x, hot_y, image);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Cursor images are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_curves(&mut self, red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_color_curves(red, green, blue);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color curves are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_lut(&mut self, size: usize, lut: &[u32]) -> Result<()> {
+        let check_res = buffer_helper::check_color_lut(size, lut);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color luts are only supported on X11".to_owned()))
+    }
+
+    pub fn clear_color_transform(&mut self) {
+    }
+
+    pub fn set_post_effects(&mut self, _effects: PostEffects) {
+    }
+
+    pub fn set_latency_tracking(&mut self, _enable: bool) {
+    }
+
+    pub fn latency_histogram(&self) -> Option<LatencyHistogram> {
+        None
+    }
+
     #[inline]
     pub fn get_keys(&self) -> Option<Vec<Key>> {
         self.key_handler.get_keys()
@@ -2,11 +2,25 @@
 pub mod macos;
 #[cfg(target_os = "windows")]
 pub mod windows;
+#[cfg(all(not(feature = "rfb"),
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
+pub mod unix;
+#[cfg(all(feature = "rfb",
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
+pub mod rfb;
 #[cfg(any(target_os="linux",
     target_os="freebsd",
     target_os="dragonfly",
     target_os="netbsd",
     target_os="openbsd"))]
-pub mod unix;
+pub mod keysym;
 #[cfg(target_os = "redox")]
 pub mod redox;
@@ -0,0 +1,1181 @@
+#![cfg(all(feature = "rfb",
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
+
+//
+// RFB (VNC) server backend. Instead of opening a window the buffer sent to update_with_buffer is served to
+// VNC viewers and their input is fed back as keyboard and mouse input of the window. Only changed 16x16 tiles are
+// sent and they are encoded as Raw or RRE. The server listens on the address in MINIFB_RFB_ADDR, either
+// host:port (default 127.0.0.1:5900) or unix:/path/to/socket.
+//
+
+use {MouseMode, MouseButton, Scale, Key, KeyRepeat, WindowOptions, InputCallback, PostEffects, LatencyHistogram, PointerSample, YuvFrame};
+use key_handler::KeyHandler;
+use os::keysym;
+use error::Error;
+use Result;
+use {CursorStyle, MenuItem, MenuItemHandle, MenuHandle, UnixMenu, UnixMenuItem};
+use mouse_handler;
+use buffer_helper;
+
+use std::cmp;
+use std::env;
+use std::fs;
+use std::io::{self, Read, Write};
+use std::net::TcpListener;
+use std::os::raw;
+use std::os::unix::net::UnixListener;
+use std::ptr;
+
+const DEFAULT_ADDRESS: &'static str = "127.0.0.1:5900";
+const TILE_SIZE: usize = 16;
+
+// Client to server messages
+const MSG_SET_PIXEL_FORMAT: u8 = 0;
+const MSG_SET_ENCODINGS: u8 = 2;
+const MSG_UPDATE_REQUEST: u8 = 3;
+const MSG_KEY_EVENT: u8 = 4;
+const MSG_POINTER_EVENT: u8 = 5;
+const MSG_CUT_TEXT: u8 = 6;
+
+// The clipboard isn't used so the text is only skipped, longer texts close the connection
+const MAX_CUT_TEXT: usize = 1 << 20;
+
+const ENCODING_RAW: i32 = 0;
+const ENCODING_RRE: i32 = 2;
+
+trait Stream: Read + Write {}
+impl<T: Read + Write> Stream for T {}
+
+#[derive(Clone, Copy)]
+struct Rect {
+    x: usize,
+    y: usize,
+    width: usize,
+    height: usize,
+}
+
+fn read_u16(data: &[u8]) -> usize {
+    ((data[0] as usize) << 8) | data[1] as usize
+}
+
+fn read_u32(data: &[u8]) -> u32 {
+    ((data[0] as u32) << 24) | ((data[1] as u32) << 16) | ((data[2] as u32) << 8) | data[3] as u32
+}
+
+fn write_u16(out: &mut Vec<u8>, v: usize) {
+    out.push((v >> 8) as u8);
+    out.push(v as u8);
+}
+
+fn write_u32(out: &mut Vec<u8>, v: u32) {
+    out.push((v >> 24) as u8);
+    out.push((v >> 16) as u8);
+    out.push((v >> 8) as u8);
+    out.push(v as u8);
+}
+
+fn write_rect_header(out: &mut Vec<u8>, rect: &Rect, encoding: i32) {
+    write_u16(out, rect.x);
+    write_u16(out, rect.y);
+    write_u16(out, rect.width);
+    write_u16(out, rect.height);
+    write_u32(out, encoding as u32);
+}
+
+///
+/// Pixel format requested by a client. Only true color formats are supported.
+///
+#[derive(Clone, Copy, PartialEq)]
+struct PixelFormat {
+    bits_per_pixel: u8,
+    depth: u8,
+    big_endian: bool,
+    red_max: u16,
+    green_max: u16,
+    blue_max: u16,
+    red_shift: u8,
+    green_shift: u8,
+    blue_shift: u8,
+}
+
+impl PixelFormat {
+    // Same layout as the buffers given to update_with_buffer
+    fn native() -> PixelFormat {
+        PixelFormat {
+            bits_per_pixel: 32,
+            depth: 24,
+            big_endian: false,
+            red_max: 255,
+            green_max: 255,
+            blue_max: 255,
+            red_shift: 16,
+            green_shift: 8,
+            blue_shift: 0,
+        }
+    }
+
+    // Returns None for color map formats and formats where a channel doesn't fit in the pixel
+    fn parse(data: &[u8]) -> Option<PixelFormat> {
+        let format = PixelFormat {
+            bits_per_pixel: data[0],
+            depth: data[1],
+            big_endian: data[2] != 0,
+            red_max: read_u16(&data[4..]) as u16,
+            green_max: read_u16(&data[6..]) as u16,
+            blue_max: read_u16(&data[8..]) as u16,
+            red_shift: data[10],
+            green_shift: data[11],
+            blue_shift: data[12],
+        };
+
+        match (data[3] != 0, format.bits_per_pixel) {
+            (true, 8) | (true, 16) | (true, 32) => (),
+            _ => return None,
+        }
+
+        let fits = |max: u16, shift: u8| {
+            shift < format.bits_per_pixel && ((max as u64) << shift) < (1u64 << format.bits_per_pixel)
+        };
+
+        if fits(format.red_max, format.red_shift) && fits(format.green_max, format.green_shift) &&
+           fits(format.blue_max, format.blue_shift) {
+            Some(format)
+        } else {
+            None
+        }
+    }
+
+    fn write(&self, out: &mut Vec<u8>) {
+        out.push(self.bits_per_pixel);
+        out.push(self.depth);
+        out.push(self.big_endian as u8);
+        out.push(1);
+        write_u16(out, self.red_max as usize);
+        write_u16(out, self.green_max as usize);
+        write_u16(out, self.blue_max as usize);
+        out.push(self.red_shift);
+        out.push(self.green_shift);
+        out.push(self.blue_shift);
+        out.extend_from_slice(&[0, 0, 0]);
+    }
+
+    fn bytes_per_pixel(&self) -> usize {
+        self.bits_per_pixel as usize / 8
+    }
+
+    fn put_pixel(&self, out: &mut Vec<u8>, pixel: u32) {
+        let v = if *self == PixelFormat::native() {
+            pixel
+        } else {
+            let r = ((pixel >> 16) & 0xff) * self.red_max as u32 / 255;
+            let g = ((pixel >> 8) & 0xff) * self.green_max as u32 / 255;
+            let b = (pixel & 0xff) * self.blue_max as u32 / 255;
+            (r << self.red_shift) | (g << self.green_shift) | (b << self.blue_shift)
+        };
+
+        match (self.bits_per_pixel, self.big_endian) {
+            (8, _) => out.push(v as u8),
+            (16, false) => out.extend_from_slice(&[v as u8, (v >> 8) as u8]),
+            (16, true) => out.extend_from_slice(&[(v >> 8) as u8, v as u8]),
+            (_, false) => out.extend_from_slice(&[v as u8, (v >> 8) as u8, (v >> 16) as u8, (v >> 24) as u8]),
+            (_, true) => out.extend_from_slice(&[(v >> 24) as u8, (v >> 16) as u8, (v >> 8) as u8, v as u8]),
+        }
+    }
+}
+
+enum InputEvent {
+    Key(bool, u32),
+    Pointer(u8, usize, usize),
+}
+
+#[derive(PartialEq)]
+enum ClientState {
+    Version,
+    Security,
+    Init,
+    Normal,
+}
+
+struct Client {
+    stream: Box<Stream>,
+    state: ClientState,
+    minor_version: u32,
+    input: Vec<u8>,
+    output: Vec<u8>,
+    format: PixelFormat,
+    use_rre: bool,
+    // Tiles that have changed since they were last sent
+    damage: Vec<bool>,
+    request: Option<Rect>,
+    // Bytes of cut text that are still to be skipped
+    skip_text: usize,
+    closed: bool,
+}
+
+impl Client {
+    fn new(stream: Box<Stream>, tile_count: usize) -> Client {
+        let mut client = Client {
+            stream: stream,
+            state: ClientState::Version,
+            minor_version: 3,
+            input: Vec::new(),
+            output: Vec::new(),
+            format: PixelFormat::native(),
+            use_rre: false,
+            damage: vec![true; tile_count],
+            request: None,
+            skip_text: 0,
+            closed: false,
+        };
+
+        client.output.extend_from_slice(b"RFB 003.008\n");
+        client
+    }
+
+    fn read(&mut self) {
+        let mut data = [0u8; 4096];
+
+        loop {
+            match self.stream.read(&mut data) {
+                Ok(0) => {
+                    self.closed = true;
+                    return;
+                }
+                Ok(count) => self.input.extend_from_slice(&data[..count]),
+                Err(ref e) if e.kind() == io::ErrorKind::WouldBlock => return,
+                Err(ref e) if e.kind() == io::ErrorKind::Interrupted => (),
+                Err(_) => {
+                    self.closed = true;
+                    return;
+                }
+            }
+        }
+    }
+
+    fn flush(&mut self) {
+        while !self.output.is_empty() && !self.closed {
+            match self.stream.write(&self.output) {
+                Ok(0) => self.closed = true,
+                Ok(count) => {
+                    self.output.drain(..count);
+                }
+                Err(ref e) if e.kind() == io::ErrorKind::WouldBlock => return,
+                Err(ref e) if e.kind() == io::ErrorKind::Interrupted => (),
+                Err(_) => self.closed = true,
+            }
+        }
+    }
+
+    fn damage_rect(&mut self, rect: &Rect, tiles_x: usize) {
+        for ty in rect.y / TILE_SIZE..(rect.y + rect.height + TILE_SIZE - 1) / TILE_SIZE {
+            for tx in rect.x / TILE_SIZE..(rect.x + rect.width + TILE_SIZE - 1) / TILE_SIZE {
+                self.damage[ty * tiles_x + tx] = true;
+            }
+        }
+    }
+
+    // Returns the size of the next complete message in the input or 0 if more data is needed
+    fn message_size(&self) -> usize {
+        let input = &self.input;
+
+        if input.is_empty() {
+            return 0;
+        }
+
+        let size = match self.state {
+            ClientState::Version => 12,
+            ClientState::Security | ClientState::Init => 1,
+            ClientState::Normal => {
+                match input[0] {
+                    MSG_SET_PIXEL_FORMAT => 20,
+                    MSG_SET_ENCODINGS if input.len() >= 4 => 4 + read_u16(&input[2..]) * 4,
+                    MSG_UPDATE_REQUEST => 10,
+                    MSG_KEY_EVENT => 8,
+                    MSG_POINTER_EVENT => 6,
+                    MSG_CUT_TEXT => 8,
+                    MSG_SET_ENCODINGS => return 0,
+                    _ => 1,
+                }
+            }
+        };
+
+        if input.len() >= size { size } else { 0 }
+    }
+
+    fn parse(&mut self, width: usize, height: usize, name: &str, events: &mut Vec<InputEvent>) {
+        let tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+
+        loop {
+            if self.skip_text > 0 {
+                let count = cmp::min(self.skip_text, self.input.len());
+                self.input.drain(..count);
+                self.skip_text -= count;
+
+                if self.skip_text > 0 {
+                    return;
+                }
+            }
+
+            let size = self.message_size();
+
+            if size == 0 || self.closed {
+                return;
+            }
+
+            let message: Vec<u8> = self.input.drain(..size).collect();
+
+            match self.state {
+                ClientState::Version => {
+                    if &message[..4] != b"RFB " {
+                        self.closed = true;
+                        return;
+                    }
+
+                    self.minor_version = cmp::min(message[10].wrapping_sub(b'0') as u32, 8);
+
+                    // 3.3 has no negotiation and the server decides to use no authentication
+                    if self.minor_version >= 7 {
+                        self.output.extend_from_slice(&[1, 1]);
+                        self.state = ClientState::Security;
+                    } else {
+                        write_u32(&mut self.output, 1);
+                        self.state = ClientState::Init;
+                    }
+                }
+
+                ClientState::Security => {
+                    if message[0] != 1 {
+                        self.closed = true;
+                        return;
+                    }
+
+                    if self.minor_version >= 8 {
+                        write_u32(&mut self.output, 0);
+                    }
+
+                    self.state = ClientState::Init;
+                }
+
+                ClientState::Init => {
+                    write_u16(&mut self.output, width);
+                    write_u16(&mut self.output, height);
+                    PixelFormat::native().write(&mut self.output);
+                    write_u32(&mut self.output, name.len() as u32);
+                    self.output.extend_from_slice(name.as_bytes());
+                    self.state = ClientState::Normal;
+                }
+
+                ClientState::Normal => {
+                    match message[0] {
+                        MSG_SET_PIXEL_FORMAT => {
+                            if let Some(format) = PixelFormat::parse(&message[4..]) {
+                                self.format = format;
+                            }
+                        }
+
+                        MSG_SET_ENCODINGS => {
+                            self.use_rre = message[4..].chunks(4).any(|e| read_u32(e) as i32 == ENCODING_RRE);
+                        }
+
+                        MSG_UPDATE_REQUEST => {
+                            let x = cmp::min(read_u16(&message[2..]), width);
+                            let y = cmp::min(read_u16(&message[4..]), height);
+                            let rect = Rect {
+                                x: x,
+                                y: y,
+                                width: cmp::min(read_u16(&message[6..]), width - x),
+                                height: cmp::min(read_u16(&message[8..]), height - y),
+                            };
+
+                            if message[1] == 0 {
+                                self.damage_rect(&rect, tiles_x);
+                            }
+
+                            self.request = Some(rect);
+                        }
+
+                        MSG_KEY_EVENT => events.push(InputEvent::Key(message[1] != 0, read_u32(&message[4..]))),
+                        MSG_POINTER_EVENT => {
+                            events.push(InputEvent::Pointer(message[1], read_u16(&message[2..]), read_u16(&message[4..])))
+                        }
+                        MSG_CUT_TEXT => {
+                            self.skip_text = read_u32(&message[4..]) as usize;
+
+                            if self.skip_text > MAX_CUT_TEXT {
+                                println!("RFB cut text of {} bytes is too long, closing connection", self.skip_text);
+                                self.closed = true;
+                            }
+                        }
+
+                        _ => {
+                            println!("Unsupported RFB message {}, closing connection", message[0]);
+                            self.closed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    //
+    // Sends the damaged tiles within the requested area. Damaged tiles on the same row are sent as one rectangle and
+    // rectangles that span the same columns in consecutive rows are merged.
+    //
+    fn send_update(&mut self, frame: &[u32], width: usize, height: usize) {
+        // Don't queue more on top of a slow client, the damage keeps accumulating until it's caught up
+        if self.state != ClientState::Normal || self.request.is_none() || !self.output.is_empty() {
+            return;
+        }
+
+        let request = self.request.unwrap();
+        let tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        let tx0 = request.x / TILE_SIZE;
+        let tx1 = (request.x + request.width + TILE_SIZE - 1) / TILE_SIZE;
+        let ty0 = request.y / TILE_SIZE;
+        let ty1 = (request.y + request.height + TILE_SIZE - 1) / TILE_SIZE;
+        let mut rects: Vec<Rect> = Vec::new();
+        let mut prev_row: Vec<usize> = Vec::new();
+
+        for ty in ty0..ty1 {
+            let y0 = cmp::max(ty * TILE_SIZE, request.y);
+            let y1 = cmp::min((ty + 1) * TILE_SIZE, request.y + request.height);
+            let mut row = Vec::new();
+            let mut tx = tx0;
+
+            while tx < tx1 {
+                if !self.damage[ty * tiles_x + tx] {
+                    tx += 1;
+                    continue;
+                }
+
+                let start = tx;
+
+                while tx < tx1 && self.damage[ty * tiles_x + tx] {
+                    // Tiles only partly inside the request are sent but stay damaged
+                    let tile_x1 = cmp::min((tx + 1) * TILE_SIZE, width);
+                    let tile_y1 = cmp::min((ty + 1) * TILE_SIZE, height);
+
+                    if tx * TILE_SIZE >= request.x && tile_x1 <= request.x + request.width &&
+                       ty * TILE_SIZE >= request.y && tile_y1 <= request.y + request.height {
+                        self.damage[ty * tiles_x + tx] = false;
+                    }
+
+                    tx += 1;
+                }
+
+                let x0 = cmp::max(start * TILE_SIZE, request.x);
+                let x1 = cmp::min(tx * TILE_SIZE, request.x + request.width);
+
+                match prev_row.iter().find(|&&i| rects[i].x == x0 && rects[i].width == x1 - x0).cloned() {
+                    Some(i) => {
+                        rects[i].height = y1 - rects[i].y;
+                        row.push(i);
+                    }
+                    None => {
+                        rects.push(Rect { x: x0, y: y0, width: x1 - x0, height: y1 - y0 });
+                        row.push(rects.len() - 1);
+                    }
+                }
+            }
+
+            prev_row = row;
+        }
+
+        // Incremental requests are answered when something changes
+        if rects.is_empty() {
+            return;
+        }
+
+        if rects.len() > 0xffff {
+            rects = vec![request];
+        }
+
+        self.request = None;
+
+        self.output.extend_from_slice(&[0, 0]);
+        write_u16(&mut self.output, rects.len());
+
+        for rect in &rects {
+            if !self.use_rre || !self.encode_rre(frame, width, rect) {
+                self.encode_raw(frame, width, rect);
+            }
+        }
+    }
+
+    fn encode_raw(&mut self, frame: &[u32], width: usize, rect: &Rect) {
+        let format = self.format;
+        let output = &mut self.output;
+
+        write_rect_header(output, rect, ENCODING_RAW);
+        output.reserve(rect.width * rect.height * format.bytes_per_pixel());
+
+        for y in rect.y..rect.y + rect.height {
+            for &pixel in &frame[y * width + rect.x..y * width + rect.x + rect.width] {
+                format.put_pixel(output, pixel);
+            }
+        }
+    }
+
+    //
+    // Encodes the rectangle as a background color with solid sub rectangles. Runs of the same color on a row are
+    // merged with a run at the same place on the row above. Gives up (returns false) as soon as it becomes larger
+    // than the raw encoding.
+    //
+    fn encode_rre(&mut self, frame: &[u32], width: usize, rect: &Rect) -> bool {
+        let bpp = self.format.bytes_per_pixel();
+        let max_subrects = (rect.width * rect.height * bpp) / (bpp + 8);
+        let background = frame[rect.y * width + rect.x];
+        let mut subrects: Vec<(u32, Rect)> = Vec::new();
+        let mut prev_row: Vec<usize> = Vec::new();
+
+        for y in 0..rect.height {
+            let start = (rect.y + y) * width + rect.x;
+            let line = &frame[start..start + rect.width];
+            let mut row = Vec::new();
+            let mut x = 0;
+
+            while x < rect.width {
+                let color = line[x];
+
+                if color == background {
+                    x += 1;
+                    continue;
+                }
+
+                let run_start = x;
+
+                while x < rect.width && line[x] == color {
+                    x += 1;
+                }
+
+                let run_width = x - run_start;
+                let found = prev_row.iter().find(|&&i| {
+                    subrects[i].0 == color && subrects[i].1.x == run_start && subrects[i].1.width == run_width
+                }).cloned();
+
+                match found {
+                    Some(i) => {
+                        subrects[i].1.height += 1;
+                        row.push(i);
+                    }
+                    None => {
+                        if subrects.len() >= max_subrects {
+                            return false;
+                        }
+
+                        subrects.push((color, Rect { x: run_start, y: y, width: run_width, height: 1 }));
+                        row.push(subrects.len() - 1);
+                    }
+                }
+            }
+
+            prev_row = row;
+        }
+
+        let format = self.format;
+        let output = &mut self.output;
+
+        write_rect_header(output, rect, ENCODING_RRE);
+        write_u32(output, subrects.len() as u32);
+        format.put_pixel(output, background);
+
+        for &(color, ref sub) in &subrects {
+            format.put_pixel(output, color);
+            write_u16(output, sub.x);
+            write_u16(output, sub.y);
+            write_u16(output, sub.width);
+            write_u16(output, sub.height);
+        }
+
+        true
+    }
+}
+
+enum Listener {
+    Tcp(TcpListener),
+    Unix(UnixListener, String),
+}
+
+impl Listener {
+    fn bind(address: &str) -> io::Result<Listener> {
+        let listener = if address.starts_with("unix:") {
+            let path = &address[5..];
+            let _ = fs::remove_file(path);
+
+            match UnixListener::bind(path) {
+                Ok(l) => Listener::Unix(l, path.to_owned()),
+                Err(e) => return Err(e),
+            }
+        } else {
+            match TcpListener::bind(address) {
+                Ok(l) => Listener::Tcp(l),
+                Err(e) => return Err(e),
+            }
+        };
+
+        let res = match listener {
+            Listener::Tcp(ref l) => l.set_nonblocking(true),
+            Listener::Unix(ref l, _) => l.set_nonblocking(true),
+        };
+
+        match res {
+            Ok(_) => Ok(listener),
+            Err(e) => Err(e),
+        }
+    }
+
+    fn accept(&self) -> Option<Box<Stream>> {
+        match *self {
+            Listener::Tcp(ref l) => {
+                match l.accept() {
+                    Ok((stream, _)) => {
+                        let _ = stream.set_nodelay(true);
+                        if stream.set_nonblocking(true).is_ok() { Some(Box::new(stream)) } else { None }
+                    }
+                    Err(_) => None,
+                }
+            }
+            Listener::Unix(ref l, _) => {
+                match l.accept() {
+                    Ok((stream, _)) => {
+                        if stream.set_nonblocking(true).is_ok() { Some(Box::new(stream)) } else { None }
+                    }
+                    Err(_) => None,
+                }
+            }
+        }
+    }
+}
+
+impl Drop for Listener {
+    fn drop(&mut self) {
+        if let Listener::Unix(_, ref path) = *self {
+            let _ = fs::remove_file(path);
+        }
+    }
+}
+
+#[derive(Default)]
+struct MouseState {
+    x: f32,
+    y: f32,
+    scroll_x: f32,
+    scroll_y: f32,
+    state: [u8; 3],
+    buttons: u8,
+}
+
+pub struct Window {
+    listener: Listener,
+    clients: Vec<Client>,
+    name: String,
+    width: usize,
+    height: usize,
+    scale: usize,
+    buffer_width: usize,
+    buffer_height: usize,
+    frame: Vec<u32>,
+    has_frame: bool,
+    mouse: MouseState,
+    key_handler: KeyHandler,
+    indexed: buffer_helper::IndexedFrame,
+    menu_counter: MenuHandle,
+    menus: Vec<UnixMenu>,
+}
+
+impl Window {
+    pub fn new(name: &str, width: usize, height: usize, opts: WindowOptions) -> Result<Window> {
+        let address = env::var("MINIFB_RFB_ADDR").unwrap_or(DEFAULT_ADDRESS.to_owned());
+
+        let listener = match Listener::bind(&address) {
+            Ok(l) => l,
+            Err(e) => {
+                return Err(Error::WindowCreate(format!("Unable to listen for RFB connections on {}: {}", address, e)));
+            }
+        };
+
+        // The size is the size of the buffer, which is served to the clients unscaled. The window
+        // size reported to the application is scaled like on the other backends.
+        let scale = Self::get_scale_factor(opts.scale);
+        let (window_width, window_height) = match (width.checked_mul(scale), height.checked_mul(scale)) {
+            (Some(w), Some(h)) => (w, h),
+            _ => return Err(Error::WindowCreate(format!("Window size {} x {} is too large", width, height))),
+        };
+
+        println!("Serving {} over RFB on {}", name, address);
+
+        Ok(Window {
+            listener: listener,
+            clients: Vec::new(),
+            name: name.to_owned(),
+            width: window_width,
+            height: window_height,
+            scale: scale,
+            buffer_width: width,
+            buffer_height: height,
+            frame: vec![0; width * height],
+            has_frame: false,
+            mouse: MouseState::default(),
+            key_handler: KeyHandler::with_repeat_events(),
+            indexed: buffer_helper::IndexedFrame::new(),
+            menu_counter: MenuHandle(0),
+            menus: Vec::new(),
+        })
+    }
+
+    pub fn set_title(&mut self, title: &str) {
+        // Only seen by clients connecting after this
+        self.name = title.to_owned();
+    }
+
+    fn tile_count(&self) -> usize {
+        ((self.buffer_width + TILE_SIZE - 1) / TILE_SIZE) * ((self.buffer_height + TILE_SIZE - 1) / TILE_SIZE)
+    }
+
+    // Copies the tiles that differ from the previous frame and marks them as damaged for all clients
+    fn update_frame(&mut self, buffer: &[u32]) {
+        let width = self.buffer_width;
+        let height = self.buffer_height;
+        let tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        let tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+        let mut damaged = Vec::new();
+
+        for ty in 0..tiles_y {
+            let y0 = ty * TILE_SIZE;
+            let y1 = cmp::min(y0 + TILE_SIZE, height);
+
+            for tx in 0..tiles_x {
+                let x0 = tx * TILE_SIZE;
+                let x1 = cmp::min(x0 + TILE_SIZE, width);
+
+                let dirty = !self.has_frame ||
+                    (y0..y1).any(|y| buffer[y * width + x0..y * width + x1] != self.frame[y * width + x0..y * width + x1]);
+
+                if dirty {
+                    for y in y0..y1 {
+                        self.frame[y * width + x0..y * width + x1].copy_from_slice(&buffer[y * width + x0..y * width + x1]);
+                    }
+
+                    damaged.push(ty * tiles_x + tx);
+                }
+            }
+        }
+
+        self.has_frame = true;
+
+        for client in self.clients.iter_mut() {
+            for &tile in &damaged {
+                client.damage[tile] = true;
+            }
+        }
+    }
+
+    fn handle_event(&mut self, event: InputEvent) {
+        match event {
+            InputEvent::Key(down, sym) => {
+                // Viewers send the shifted keysym for letters but keys are mapped from the unshifted ones
+                let key_sym = if sym >= 0x41 && sym <= 0x5a { sym + 0x20 } else { sym };
+
+                // Viewers repeat held keys by sending more presses without releases
+                if let Some(key) = keysym::to_key(key_sym) {
+                    if down {
+                        let repeat = self.key_handler.is_key_down(key);
+                        self.key_handler.set_key_pressed(key, repeat);
+                    } else {
+                        self.key_handler.set_key_state(key, false);
+                    }
+                }
+
+                // Latin-1 keysyms are the same as the code points and Unicode keysyms have the code point in the
+                // lower bits
+                let code_point = if sym & 0xff000000 == 0x01000000 { sym & 0xffffff } else if sym < 0x100 { sym } else { 0 };
+
+                if down && code_point >= 32 && !(code_point > 126 && code_point < 160) {
+                    if let Some(ref mut callback) = self.key_handler.key_callback {
+                        callback.add_char(code_point);
+                    }
+                }
+            }
+
+            InputEvent::Pointer(buttons, x, y) => {
+                let pressed = buttons & !self.mouse.buttons;
+
+                self.mouse.x = (x * self.scale) as f32;
+                self.mouse.y = (y * self.scale) as f32;
+                self.mouse.state[0] = buttons & 1;
+                self.mouse.state[1] = (buttons >> 1) & 1;
+                self.mouse.state[2] = (buttons >> 2) & 1;
+
+                // Buttons 4-7 are the scroll wheel
+                if pressed & 8 != 0 { self.mouse.scroll_y = 10.0; }
+                if pressed & 16 != 0 { self.mouse.scroll_y = -10.0; }
+                if pressed & 32 != 0 { self.mouse.scroll_x = 10.0; }
+                if pressed & 64 != 0 { self.mouse.scroll_x = -10.0; }
+
+                self.mouse.buttons = buttons;
+            }
+        }
+    }
+
+    //
+    // Accepts new clients, handles their messages and sends updates to the ones that have asked for it
+    //
+    fn poll(&mut self) {
+        let tile_count = self.tile_count();
+        let mut events = Vec::new();
+
+        while let Some(stream) = self.listener.accept() {
+            self.clients.push(Client::new(stream, tile_count));
+        }
+
+        for client in self.clients.iter_mut() {
+            client.read();
+            client.parse(self.buffer_width, self.buffer_height, &self.name, &mut events);
+
+            if self.has_frame {
+                client.send_update(&self.frame, self.buffer_width, self.buffer_height);
+            }
+
+            client.flush();
+        }
+
+        self.clients.retain(|client| !client.closed);
+
+        for event in events {
+            self.handle_event(event);
+        }
+    }
+
+    pub fn update_with_buffer(&mut self, buffer: &[u32]) -> Result<()> {
+        self.key_handler.update();
+
+        let check_res = buffer_helper::check_buffer_size(self.width, self.height, self.scale, buffer);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        self.update_frame(buffer);
+
+        self.mouse.scroll_x = 0.0;
+        self.mouse.scroll_y = 0.0;
+        self.poll();
+
+        Ok(())
+    }
+
+    pub fn update_with_buffer_stride(&mut self, buffer: &[u32], x: usize, y: usize, stride: usize) -> Result<()> {
+        let check_res = buffer_helper::check_buffer_stride(self.width, self.height, self.scale,
+                                                           x, y, stride, buffer);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_buffer_stride(self.width, self.height, self.scale,
+                                                       x, y, stride, buffer);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_yuv(&mut self, frame: &YuvFrame) -> Result<()> {
+        let check_res = buffer_helper::check_yuv_frame(self.width, self.height, self.scale, frame);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_yuv_frame(self.width, self.height, self.scale, frame);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        self.indexed.set_palette(palette)
+    }
+
+    pub fn update_with_indexed(&mut self, indices: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_indexed_buffer(self.width, self.height, self.scale, indices);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = self.indexed.expand(self.width, self.height, self.scale, indices);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let check_res = self.indexed.set_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        match self.indexed.expand_cached() {
+            Some(packed) => self.update_with_buffer(&packed),
+            None => Err(buffer_helper::no_indexed_frame()),
+        }
+    }
+
+    pub fn scroll_region(&mut self, buffer: &[u32], _dx: isize, _dy: isize,
+                         x: usize, y: usize, width: usize, height: usize) -> Result<()> {
+        let check_res = buffer_helper::check_region(self.width, self.height, self.scale,
+                                                    x, y, width, height);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        // The damage detection only sends the tiles that changed
+        self.update_with_buffer(buffer)
+    }
+
+    pub fn update_tile(&mut self, _frame: *const u32, _x: usize, _y: usize, _width: usize, _height: usize) -> bool {
+        // The caller presents the finished frame as a whole
+        false
+    }
+
+    pub fn finish_tiles(&mut self) {
+    }
+
+    pub fn update(&mut self) {
+        self.key_handler.update();
+
+        self.mouse.scroll_x = 0.0;
+        self.mouse.scroll_y = 0.0;
+        self.poll();
+    }
+
+    pub fn dispatch_pending(&mut self) {
+        self.update();
+    }
+
+    #[inline]
+    pub fn get_window_handle(&self) -> *mut raw::c_void {
+        ptr::null_mut()
+    }
+
+    #[inline]
+    pub fn set_position(&mut self, _x: isize, _y: isize) {
+    }
+
+    pub fn get_size(&self) -> (usize, usize) {
+        (self.width, self.height)
+    }
+
+    pub fn get_mouse_pos(&self, mode: MouseMode) -> Option<(f32, f32)> {
+        mouse_handler::get_pos(mode, self.mouse.x, self.mouse.y, self.scale as f32, self.width as f32, self.height as f32)
+    }
+
+    pub fn get_unscaled_mouse_pos(&self, mode: MouseMode) -> Option<(f32, f32)> {
+        mouse_handler::get_pos(mode, self.mouse.x, self.mouse.y, 1.0, self.width as f32, self.height as f32)
+    }
+
+    pub fn get_mouse_down(&self, button: MouseButton) -> bool {
+        match button {
+            MouseButton::Left => self.mouse.state[0] > 0,
+            MouseButton::Middle => self.mouse.state[1] > 0,
+            MouseButton::Right => self.mouse.state[2] > 0,
+        }
+    }
+
+    pub fn get_scroll_wheel(&self) -> Option<(f32, f32)> {
+        if self.mouse.scroll_x.abs() > 0.0 || self.mouse.scroll_y.abs() > 0.0 {
+            Some((self.mouse.scroll_x, self.mouse.scroll_y))
+        } else {
+            None
+        }
+    }
+
+    pub fn set_precise_pointer(&mut self, _enable: bool) -> bool {
+        false
+    }
+
+    pub fn get_pointer_history(&self) -> &[PointerSample] {
+        &[]
+    }
+
+    #[inline]
+    pub fn set_cursor_style(&mut self, _cursor: CursorStyle) {
+    }
+
+    pub fn set_cursor_image(&mut self, image: &[u32], width: usize, height: usize,
+                            hot_x: usize, hot_y: usize) -> Result<()> {
+        let check_res = buffer_helper::check_cursor_image(width, height, hot_x, hot_y, image);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Cursor images are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_curves(&mut self, red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_color_curves(red, green, blue);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color curves are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_lut(&mut self, size: usize, lut: &[u32]) -> Result<()> {
+        let check_res = buffer_helper::check_color_lut(size, lut);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color luts are only supported on X11".to_owned()))
+    }
+
+    pub fn clear_color_transform(&mut self) {
+    }
+
+    pub fn set_post_effects(&mut self, _effects: PostEffects) {
+    }
+
+    pub fn set_latency_tracking(&mut self, _enable: bool) {
+    }
+
+    pub fn latency_histogram(&self) -> Option<LatencyHistogram> {
+        None
+    }
+
+    #[inline]
+    pub fn get_keys(&self) -> Option<Vec<Key>> {
+        self.key_handler.get_keys()
+    }
+
+    #[inline]
+    pub fn get_keys_pressed(&self, repeat: KeyRepeat) -> Option<Vec<Key>> {
+        self.key_handler.get_keys_pressed(repeat)
+    }
+
+    #[inline]
+    pub fn is_key_down(&self, key: Key) -> bool {
+        self.key_handler.is_key_down(key)
+    }
+
+    #[inline]
+    pub fn set_key_repeat_delay(&mut self, delay: f32) {
+        self.key_handler.set_key_repeat_delay(delay)
+    }
+
+    #[inline]
+    pub fn set_key_repeat_rate(&mut self, rate: f32) {
+        self.key_handler.set_key_repeat_rate(rate)
+    }
+
+    #[inline]
+    pub fn is_key_pressed(&self, key: Key, repeat: KeyRepeat) -> bool {
+        self.key_handler.is_key_pressed(key, repeat)
+    }
+
+    #[inline]
+    pub fn is_key_released(&self, key: Key) -> bool {
+        self.key_handler.is_key_released(key)
+    }
+
+    #[inline]
+    pub fn set_input_callback(&mut self, callback: Box<InputCallback>)  {
+        self.key_handler.set_input_callback(callback)
+    }
+
+    #[inline]
+    pub fn is_open(&self) -> bool {
+        true
+    }
+
+    #[inline]
+    pub fn is_active(&mut self) -> bool {
+        !self.clients.is_empty()
+    }
+
+    // There is no screen to fit to so FitScreen is the same as X1
+    fn get_scale_factor(scale: Scale) -> usize {
+        match scale {
+            Scale::X1 | Scale::FitScreen => 1,
+            Scale::X2 => 2,
+            Scale::X4 => 4,
+            Scale::X8 => 8,
+            Scale::X16 => 16,
+            Scale::X32 => 32,
+        }
+    }
+
+    fn next_menu_handle(&mut self) -> MenuHandle {
+        let handle = self.menu_counter;
+        self.menu_counter.0 += 1;
+        handle
+    }
+
+    pub fn add_menu(&mut self, menu: &Menu) -> MenuHandle {
+        let handle = self.next_menu_handle();
+        let mut menu = menu.internal.clone();
+        menu.handle = handle;
+        self.menus.push(menu);
+        handle
+    }
+
+    pub fn get_unix_menus(&self) -> Option<&Vec<UnixMenu>> {
+        Some(&self.menus)
+    }
+
+    pub fn remove_menu(&mut self, handle: MenuHandle) {
+        self.menus.retain(|ref menu| menu.handle != handle);
+    }
+
+    pub fn is_menu_pressed(&mut self) -> Option<usize> {
+        None
+    }
+}
+
+pub struct Menu {
+    pub internal: UnixMenu,
+}
+
+impl Menu {
+    pub fn new(name: &str) -> Result<Menu> {
+        Ok(Menu {
+            internal: UnixMenu {
+                handle: MenuHandle(0),
+                item_counter: MenuItemHandle(0),
+                name: name.to_owned(),
+                items: Vec::new(),
+            }
+        })
+    }
+
+    pub fn add_sub_menu(&mut self, name: &str, sub_menu: &Menu) {
+        let handle = self.next_item_handle();
+        self.internal.items.push(UnixMenuItem {
+            label: name.to_owned(),
+            handle: handle,
+            sub_menu: Some(Box::new(sub_menu.internal.clone())),
+            id: 0,
+            enabled: true,
+            key: Key::Unknown,
+            modifier: 0,
+        });
+    }
+
+    fn next_item_handle(&mut self) -> MenuItemHandle {
+        let handle = self.internal.item_counter;
+        self.internal.item_counter.0 += 1;
+        handle
+    }
+
+    pub fn add_menu_item(&mut self, item: &MenuItem) -> MenuItemHandle {
+        let item_handle = self.next_item_handle();
+        self.internal.items.push(UnixMenuItem {
+            sub_menu: None,
+            handle: self.internal.item_counter,
+            id: item.id,
+            label: item.label.clone(),
+            enabled: item.enabled,
+            key: item.key,
+            modifier: item.modifier,
+        });
+        item_handle
+    }
+
+    pub fn remove_item(&mut self, handle: &MenuItemHandle) {
+        self.internal.items.retain(|ref item| item.handle.0 != handle.0);
+    }
+}
@@ -1,14 +1,15 @@
-#![cfg(any(target_os="linux",
-    target_os="freebsd",
-    target_os="dragonfly",
-    target_os="netbsd",
-    target_os="openbsd"))]
-
-extern crate x11_dl;
-
-use {MouseMode, MouseButton, Scale, Key, KeyRepeat, WindowOptions, InputCallback};
+#![cfg(all(not(feature = "rfb"),
+    any(target_os="linux",
+        target_os="freebsd",
+        target_os="dragonfly",
+        target_os="netbsd",
+        target_os="openbsd")))]
+
+use {MouseMode, MouseButton, Scale, Key, KeyRepeat, WindowOptions, InputCallback, PostEffects};
+use {Rotation, Fullscreen};
+use {LatencyHistogram, PointerSample, YuvFrame, YuvFormat};
 use key_handler::KeyHandler;
-use self::x11_dl::keysym::*;
+use os::keysym;
 use error::Error;
 use Result;
 use {CursorStyle, MenuItem, MenuItemHandle, MenuHandle, UnixMenu, UnixMenuItem};
@@ -16,20 +17,43 @@ use {CursorStyle, MenuItem, MenuItemHandle, MenuHandle, UnixMenu, UnixMenuItem};
 use std::os::raw::{c_void, c_char, c_uchar};
 use std::ffi::{CString};
 use std::ptr;
+use std::slice;
 use std::mem;
 use std::os::raw;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::cell::RefCell;
 use mouse_handler;
 use buffer_helper;
 use window_flags;
+use trace;
+use pool::WorkerPool;
+
+// Needs to match LATENCY_BUCKETS in X11MiniFB.c
+const LATENCY_BUCKETS: usize = 128;
 
 #[link(name = "X11")]
 #[link(name = "Xcursor")]
+#[link(name = "Xrender")]
+#[link(name = "Xi")]
+#[link(name = "Xinerama")]
 extern {
     fn mfb_open(name: *const c_char, width: u32, height: u32, flags: u32, scale: i32) -> *mut c_void;
     fn mfb_set_title(window: *mut c_void, title: *const c_char);
     fn mfb_close(window: *mut c_void);
     fn mfb_update(window: *mut c_void);
     fn mfb_update_with_buffer(window: *mut c_void, buffer: *const c_uchar);
+    fn mfb_update_with_buffer_stride(window: *mut c_void, buffer: *const c_uchar, stride: i32);
+    fn mfb_update_with_yuv(window: *mut c_void, y: *const u8, y_stride: i32, u: *const u8, u_stride: i32,
+                           v: *const u8, v_stride: i32, nv12: i32, coefficients: *const i16) -> i32;
+    fn mfb_update_with_indexed(window: *mut c_void, indices: *const u8) -> i32;
+    fn mfb_set_palette(window: *mut c_void, colors: *const u32, first: i32, count: i32);
+    fn mfb_scroll_region(window: *mut c_void, buffer: *const c_uchar, stride: i32, dx: i32, dy: i32,
+                         x: i32, y: i32, width: i32, height: i32);
+    fn mfb_prepare_buffer(window: *mut c_void, buffer: *const c_uchar, stride: i32) -> i32;
+    fn mfb_update_tile(window: *mut c_void, buffer: *const c_uchar, x: i32, y: i32, width: i32, height: i32) -> i32;
+    fn mfb_finish_tiles(window: *mut c_void);
+    fn mfb_update_mirrored(windows: *mut *mut c_void, count: i32, buffer: *const c_uchar);
+    fn mfb_update_prepared(windows: *mut *mut c_void, count: i32);
     fn mfb_set_position(window: *mut c_void, x: i32, y: i32);
     fn mfb_set_key_callback(window: *mut c_void, target: *mut c_void,
     						kb: unsafe extern fn(*mut c_void, i32, i32),
@@ -38,7 +62,19 @@ extern {
     fn mfb_should_close(window: *mut c_void) -> i32;
     fn mfb_get_screen_size() -> u32;
     fn mfb_set_cursor_style(window: *mut c_void, cursor: u32);
+    fn mfb_set_cursor_image(window: *mut c_void, image: *const u32, width: i32, height: i32,
+                            hot_x: i32, hot_y: i32) -> i32;
     fn mfb_get_window_handle(window: *mut c_void) -> *mut c_void;
+    fn mfb_set_color_curves(window: *mut c_void, curves: *const u8) -> i32;
+    fn mfb_set_color_lut(window: *mut c_void, lut: *const u32, size: i32) -> i32;
+    fn mfb_set_post_effects(window: *mut c_void, scanlines: i32, shadow_mask: i32, edge_blend: i32);
+    fn mfb_set_latency_tracking(window: *mut c_void, enable: i32);
+    fn mfb_get_latency_histogram(window: *mut c_void, buckets: *mut u32, count: i32) -> i32;
+    fn mfb_set_precise_pointer(window: *mut c_void, enable: i32) -> i32;
+    fn mfb_get_pointer_history(window: *mut c_void, count: *mut i32) -> *const PointerSample;
+    fn mfb_get_connection_fd() -> i32;
+    fn mfb_dispatch_pending(window: *mut c_void);
+    fn mfb_set_trace_callback(callback: Option<unsafe extern fn(*mut c_void, i32, u64, u64)>);
 }
 
 #[derive(Default)]
@@ -54,6 +90,25 @@ pub struct SharedData {
     pub state: [u8; 3],
 }
 
+// Handles that are shared with the threads preparing buffers in update_all_with_buffers.
+// The buffers are borrowed for the whole call and the pool finishes all jobs before it returns.
+struct PrepareJob {
+    window: *mut c_void,
+    buffer: *const c_uchar,
+}
+
+unsafe impl Sync for PrepareJob {}
+
+// Threads that scale the buffers in update_all_with_buffers, started the first time it's used on
+// the calling thread
+thread_local!(static PREPARE_POOL: RefCell<Option<WorkerPool>> = RefCell::new(None));
+
+impl PrepareJob {
+    unsafe fn run(&self) {
+        mfb_prepare_buffer(self.window, self.buffer, 0);
+    }
+}
+
 pub struct Window {
     window_handle: *mut c_void,
     shared_data: SharedData,
@@ -62,120 +117,34 @@ pub struct Window {
     menus: Vec<UnixMenu>,
 }
 
-#[allow(non_upper_case_globals)]
+// Set while the native layer reports its phases to the trace
+static NATIVE_TRACE: AtomicBool = AtomicBool::new(false);
+
+// Names of the phases reported by the native layer, in the order of TracePhase in X11MiniFB.c
+const TRACE_PHASES: [&'static str; 6] = ["prepare", "put", "flush", "latency", "events", "pointer"];
+
+unsafe extern "C" fn trace_callback(window: *mut c_void, phase: i32, begin: u64, end: u64) {
+    let name = TRACE_PHASES.get(phase as usize).cloned().unwrap_or("native");
+    trace::record(window as usize, name, begin, end);
+}
+
 unsafe extern "C" fn key_callback(window: *mut c_void, key: i32, s: i32) {
     let win: *mut Window = mem::transmute(window);
+    let _span = trace::span((*win).window_handle as usize, "key_callback");
 
-    let state = s == 1;
-
-    match key as u32 {
-        XK_0 => (*win).key_handler.set_key_state(Key::Key0, state),
-        XK_1 => (*win).key_handler.set_key_state(Key::Key1, state),
-        XK_2 => (*win).key_handler.set_key_state(Key::Key2, state),
-        XK_3 => (*win).key_handler.set_key_state(Key::Key3, state),
-        XK_4 => (*win).key_handler.set_key_state(Key::Key4, state),
-        XK_5 => (*win).key_handler.set_key_state(Key::Key5, state),
-        XK_6 => (*win).key_handler.set_key_state(Key::Key6, state),
-        XK_7 => (*win).key_handler.set_key_state(Key::Key7, state),
-        XK_8 => (*win).key_handler.set_key_state(Key::Key8, state),
-        XK_9 => (*win).key_handler.set_key_state(Key::Key9, state),
-        XK_a => (*win).key_handler.set_key_state(Key::A, state),
-        XK_b => (*win).key_handler.set_key_state(Key::B, state),
-        XK_c => (*win).key_handler.set_key_state(Key::C, state),
-        XK_d => (*win).key_handler.set_key_state(Key::D, state),
-        XK_e => (*win).key_handler.set_key_state(Key::E, state),
-        XK_f => (*win).key_handler.set_key_state(Key::F, state),
-        XK_g => (*win).key_handler.set_key_state(Key::G, state),
-        XK_h => (*win).key_handler.set_key_state(Key::H, state),
-        XK_i => (*win).key_handler.set_key_state(Key::I, state),
-        XK_j => (*win).key_handler.set_key_state(Key::J, state),
-        XK_k => (*win).key_handler.set_key_state(Key::K, state),
-        XK_l => (*win).key_handler.set_key_state(Key::L, state),
-        XK_m => (*win).key_handler.set_key_state(Key::M, state),
-        XK_n => (*win).key_handler.set_key_state(Key::N, state),
-        XK_o => (*win).key_handler.set_key_state(Key::O, state),
-        XK_p => (*win).key_handler.set_key_state(Key::P, state),
-        XK_q => (*win).key_handler.set_key_state(Key::Q, state),
-        XK_r => (*win).key_handler.set_key_state(Key::R, state),
-        XK_s => (*win).key_handler.set_key_state(Key::S, state),
-        XK_t => (*win).key_handler.set_key_state(Key::T, state),
-        XK_u => (*win).key_handler.set_key_state(Key::U, state),
-        XK_v => (*win).key_handler.set_key_state(Key::V, state),
-        XK_w => (*win).key_handler.set_key_state(Key::W, state),
-        XK_x => (*win).key_handler.set_key_state(Key::X, state),
-        XK_y => (*win).key_handler.set_key_state(Key::Y, state),
-        XK_z => (*win).key_handler.set_key_state(Key::Z, state),
-        XK_F1 => (*win).key_handler.set_key_state(Key::F1, state),
-        XK_F2 => (*win).key_handler.set_key_state(Key::F2, state),
-        XK_F3 => (*win).key_handler.set_key_state(Key::F3, state),
-        XK_F4 => (*win).key_handler.set_key_state(Key::F4, state),
-        XK_F5 => (*win).key_handler.set_key_state(Key::F5, state),
-        XK_F6 => (*win).key_handler.set_key_state(Key::F6, state),
-        XK_F7 => (*win).key_handler.set_key_state(Key::F7, state),
-        XK_F8 => (*win).key_handler.set_key_state(Key::F8, state),
-        XK_F9 => (*win).key_handler.set_key_state(Key::F9, state),
-        XK_F10 => (*win).key_handler.set_key_state(Key::F10, state),
-        XK_F11 => (*win).key_handler.set_key_state(Key::F11, state),
-        XK_F12 => (*win).key_handler.set_key_state(Key::F12, state),
-        XK_Down => (*win).key_handler.set_key_state(Key::Down, state),
-        XK_Left => (*win).key_handler.set_key_state(Key::Left, state),
-        XK_Right => (*win).key_handler.set_key_state(Key::Right, state),
-        XK_Up => (*win).key_handler.set_key_state(Key::Up, state),
-        XK_Escape => (*win).key_handler.set_key_state(Key::Escape, state),
-        XK_apostrophe => (*win).key_handler.set_key_state(Key::Apostrophe, state),
-        XK_grave => (*win).key_handler.set_key_state(Key::Backquote, state),
-        XK_backslash => (*win).key_handler.set_key_state(Key::Backslash, state),
-        XK_comma => (*win).key_handler.set_key_state(Key::Comma, state),
-        XK_equal => (*win).key_handler.set_key_state(Key::Equal, state),
-        XK_bracketleft => (*win).key_handler.set_key_state(Key::LeftBracket, state),
-        XK_minus => (*win).key_handler.set_key_state(Key::Minus, state),
-        XK_period => (*win).key_handler.set_key_state(Key::Period, state),
-        XK_braceright => (*win).key_handler.set_key_state(Key::RightBracket, state),
-        XK_semicolon => (*win).key_handler.set_key_state(Key::Semicolon, state),
-        XK_slash => (*win).key_handler.set_key_state(Key::Slash, state),
-        XK_BackSpace => (*win).key_handler.set_key_state(Key::Backspace, state),
-        XK_Delete => (*win).key_handler.set_key_state(Key::Delete, state),
-        XK_End => (*win).key_handler.set_key_state(Key::End, state),
-        XK_Return => (*win).key_handler.set_key_state(Key::Enter, state),
-        XK_Home => (*win).key_handler.set_key_state(Key::Home, state),
-        XK_Insert => (*win).key_handler.set_key_state(Key::Insert, state),
-        XK_Menu => (*win).key_handler.set_key_state(Key::Menu, state),
-        XK_Page_Down => (*win).key_handler.set_key_state(Key::PageDown, state),
-        XK_Page_Up => (*win).key_handler.set_key_state(Key::PageUp, state),
-        XK_Pause => (*win).key_handler.set_key_state(Key::Pause, state),
-        XK_space => (*win).key_handler.set_key_state(Key::Space, state),
-        XK_Tab => (*win).key_handler.set_key_state(Key::Tab, state),
-        XK_Num_Lock => (*win).key_handler.set_key_state(Key::NumLock, state),
-        XK_Caps_Lock => (*win).key_handler.set_key_state(Key::CapsLock, state),
-        XK_Scroll_Lock => (*win).key_handler.set_key_state(Key::ScrollLock, state),
-        XK_Shift_L => (*win).key_handler.set_key_state(Key::LeftShift, state),
-        XK_Shift_R => (*win).key_handler.set_key_state(Key::RightShift, state),
-        XK_Control_L => (*win).key_handler.set_key_state(Key::LeftCtrl, state),
-        XK_Control_R => (*win).key_handler.set_key_state(Key::RightCtrl, state),
-        XK_KP_0 => (*win).key_handler.set_key_state(Key::NumPad0, state),
-        XK_KP_1 => (*win).key_handler.set_key_state(Key::NumPad1, state),
-        XK_KP_2 => (*win).key_handler.set_key_state(Key::NumPad2, state),
-        XK_KP_3 => (*win).key_handler.set_key_state(Key::NumPad3, state),
-        XK_KP_4 => (*win).key_handler.set_key_state(Key::NumPad4, state),
-        XK_KP_5 => (*win).key_handler.set_key_state(Key::NumPad5, state),
-        XK_KP_6 => (*win).key_handler.set_key_state(Key::NumPad6, state),
-        XK_KP_7 => (*win).key_handler.set_key_state(Key::NumPad7, state),
-        XK_KP_8 => (*win).key_handler.set_key_state(Key::NumPad8, state),
-        XK_KP_9 => (*win).key_handler.set_key_state(Key::NumPad9, state),
-        XK_KP_Decimal => (*win).key_handler.set_key_state(Key::NumPadDot, state),
-        XK_KP_Divide => (*win).key_handler.set_key_state(Key::NumPadSlash, state),
-        XK_KP_Multiply => (*win).key_handler.set_key_state(Key::NumPadAsterisk, state),
-        XK_KP_Subtract => (*win).key_handler.set_key_state(Key::NumPadMinus, state),
-        XK_KP_Add => (*win).key_handler.set_key_state(Key::NumPadPlus, state),
-        XK_KP_Enter => (*win).key_handler.set_key_state(Key::NumPadEnter, state),
-        XK_Super_L => (*win).key_handler.set_key_state(Key::LeftSuper, state),
-        XK_Super_R => (*win).key_handler.set_key_state(Key::RightSuper, state),
-    	_ => (),
+    // 0 is a release, 1 a press and 2 a repeat of a held key
+    if let Some(key) = keysym::to_key(key as u32) {
+        if s == 0 {
+            (*win).key_handler.set_key_state(key, false);
+        } else {
+            (*win).key_handler.set_key_pressed(key, s == 2);
+        }
     }
 }
 
 unsafe extern "C" fn char_callback(window: *mut c_void, code_point: u32) {
     let win: *mut Window = mem::transmute(window);
+    let _span = trace::span((*win).window_handle as usize, "char_callback");
 
     // Taken from GLFW
     if code_point < 32 || (code_point > 126 && code_point < 160) {
@@ -198,7 +167,11 @@ impl Window {
         };
 
         unsafe {
-        	let scale = Self::get_scale_factor(width, height, opts.scale);
+        	let scale = if opts.fullscreen != Fullscreen::None {
+                Self::get_fullscreen_scale(width, height, opts.rotation)
+            } else {
+                Self::get_scale_factor(width, height, opts.scale)
+            };
             let handle = mfb_open(n.as_ptr(),
             					  width as u32,
             					  height as u32,
@@ -215,7 +188,7 @@ impl Window {
                 	scale: scale as f32,
                 	.. SharedData::default()
 				},
-                key_handler: KeyHandler::new(),
+                key_handler: KeyHandler::with_repeat_events(),
                 menu_counter: MenuHandle(0),
                 menus: Vec::new(),
             })
@@ -231,9 +204,168 @@ impl Window {
 
     unsafe fn set_shared_data(&mut self) {
         mfb_set_shared_data(self.window_handle, &mut self.shared_data);
+
+        // The native layer reports its phases while a trace is recorded
+        let tracing = trace::enabled();
+
+        if NATIVE_TRACE.swap(tracing, Ordering::Relaxed) != tracing {
+            mfb_set_trace_callback(if tracing { Some(trace_callback) } else { None });
+        }
     }
 
     pub fn update_with_buffer(&mut self, buffer: &[u32]) -> Result<()> {
+        let _span = trace::span(self.window_handle as usize, "update_with_buffer");
+
+        self.key_handler.update();
+
+        let check_res = {
+            let _span = trace::span(self.window_handle as usize, "check_buffer_size");
+            buffer_helper::check_buffer_size(self.shared_data.width as usize,
+                                             self.shared_data.height as usize,
+                                             self.shared_data.scale as usize,
+                                             buffer)
+        };
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        unsafe {
+            Self::set_shared_data(self);
+            mfb_update_with_buffer(self.window_handle, buffer.as_ptr() as *const u8);
+            mfb_set_key_callback(self.window_handle,
+            					 mem::transmute(self),
+            					 key_callback,
+            					 char_callback);
+        }
+
+        Ok(())
+    }
+
+    pub fn update_with_buffer_stride(&mut self, buffer: &[u32], x: usize, y: usize, stride: usize) -> Result<()> {
+        self.key_handler.update();
+
+        let check_res = buffer_helper::check_buffer_stride(self.shared_data.width as usize,
+                                                           self.shared_data.height as usize,
+                                                           self.shared_data.scale as usize,
+                                                           x, y, stride, buffer);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        unsafe {
+            Self::set_shared_data(self);
+            mfb_update_with_buffer_stride(self.window_handle,
+                                          buffer[(y * stride) + x..].as_ptr() as *const u8,
+                                          stride as i32);
+            mfb_set_key_callback(self.window_handle,
+            					 mem::transmute(self),
+            					 key_callback,
+            					 char_callback);
+        }
+
+        Ok(())
+    }
+
+    pub fn update_with_yuv(&mut self, frame: &YuvFrame) -> Result<()> {
+        let _span = trace::span(self.window_handle as usize, "update_with_yuv");
+
+        self.key_handler.update();
+
+        let check_res = buffer_helper::check_yuv_frame(self.shared_data.width as usize,
+                                                       self.shared_data.height as usize,
+                                                       self.shared_data.scale as usize,
+                                                       frame);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let coefficients = buffer_helper::yuv_coefficients(frame);
+        let v = if frame.format == YuvFormat::I420 { frame.v.as_ptr() } else { ptr::null() };
+
+        unsafe {
+            Self::set_shared_data(self);
+            let res = mfb_update_with_yuv(self.window_handle,
+                                          frame.y.as_ptr(), frame.y_stride as i32,
+                                          frame.u.as_ptr(), frame.u_stride as i32,
+                                          v, frame.v_stride as i32,
+                                          (frame.format == YuvFormat::Nv12) as i32,
+                                          coefficients.as_ptr());
+            mfb_set_key_callback(self.window_handle,
+            					 mem::transmute(self),
+            					 key_callback,
+            					 char_callback);
+
+            if res == 0 {
+                return Err(Error::UpdateFailed("Unable to allocate the buffers for the YUV conversion".to_owned()));
+            }
+        }
+
+        Ok(())
+    }
+
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let check_res = buffer_helper::check_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        unsafe {
+            mfb_set_palette(self.window_handle, palette.as_ptr(), 0, palette.len() as i32);
+        }
+
+        Ok(())
+    }
+
+    pub fn update_with_indexed(&mut self, indices: &[u8]) -> Result<()> {
+        let _span = trace::span(self.window_handle as usize, "update_with_indexed");
+
+        let check_res = buffer_helper::check_indexed_buffer(self.shared_data.width as usize,
+                                                            self.shared_data.height as usize,
+                                                            self.shared_data.scale as usize,
+                                                            indices);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        if !self.present_indexed(indices.as_ptr()) {
+            return Err(Error::UpdateFailed("Unable to allocate the buffers for the indexed frame".to_owned()));
+        }
+
+        Ok(())
+    }
+
+    pub fn update_with_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let _span = trace::span(self.window_handle as usize, "update_with_palette");
+
+        let check_res = self.set_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        // The native side redraws the indices it kept from the last indexed frame
+        if !self.present_indexed(ptr::null()) {
+            return Err(buffer_helper::no_indexed_frame());
+        }
+
+        Ok(())
+    }
+
+    fn present_indexed(&mut self, indices: *const u8) -> bool {
+        self.key_handler.update();
+
+        unsafe {
+            Self::set_shared_data(self);
+            let res = mfb_update_with_indexed(self.window_handle, indices);
+            mfb_set_key_callback(self.window_handle,
+            					 mem::transmute(self),
+            					 key_callback,
+            					 char_callback);
+            res != 0
+        }
+    }
+
+    pub fn scroll_region(&mut self, buffer: &[u32], dx: isize, dy: isize,
+                         x: usize, y: usize, width: usize, height: usize) -> Result<()> {
         self.key_handler.update();
 
         let check_res = buffer_helper::check_buffer_size(self.shared_data.width as usize,
@@ -244,9 +376,24 @@ impl Window {
             return check_res;
         }
 
+        let check_res = buffer_helper::check_region(self.shared_data.width as usize,
+                                                    self.shared_data.height as usize,
+                                                    self.shared_data.scale as usize,
+                                                    x, y, width, height);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        if dx < i32::min_value() as isize || dx > i32::max_value() as isize ||
+           dy < i32::min_value() as isize || dy > i32::max_value() as isize {
+            let err = format!("Scroll offset {} x {} is out of range", dx, dy);
+            return Err(Error::UpdateFailed(err));
+        }
+
         unsafe {
             Self::set_shared_data(self);
-            mfb_update_with_buffer(self.window_handle, buffer.as_ptr() as *const u8);
+            mfb_scroll_region(self.window_handle, buffer.as_ptr() as *const u8, 0,
+                              dx as i32, dy as i32, x as i32, y as i32, width as i32, height as i32);
             mfb_set_key_callback(self.window_handle,
             					 mem::transmute(self),
             					 key_callback,
@@ -256,6 +403,111 @@ impl Window {
         Ok(())
     }
 
+    pub fn update_all_with_buffers(windows: &mut [(&mut Window, &[u32])]) -> Result<()> {
+        for item in windows.iter() {
+            let window = &item.0;
+            let check_res = buffer_helper::check_buffer_size(window.shared_data.width as usize,
+                                                             window.shared_data.height as usize,
+                                                             window.shared_data.scale as usize,
+                                                             item.1);
+            if check_res.is_err() {
+                return check_res;
+            }
+        }
+
+        let mut handles = Vec::with_capacity(windows.len());
+
+        unsafe {
+            for item in windows.iter_mut() {
+                let window = &mut *item.0;
+                window.key_handler.update();
+                Self::set_shared_data(window);
+                mfb_set_key_callback(window.window_handle,
+                                     mem::transmute(&mut *window),
+                                     key_callback,
+                                     char_callback);
+                handles.push(window.window_handle);
+            }
+        }
+
+        let jobs: Vec<PrepareJob> = windows.iter().map(|item| {
+            PrepareJob {
+                window: item.0.window_handle,
+                buffer: item.1.as_ptr() as *const c_uchar,
+            }
+        }).collect();
+
+        // Scale the buffers in parallel, the calling thread takes part as well
+        PREPARE_POOL.with(|pool| {
+            let mut pool = pool.borrow_mut();
+
+            if pool.is_none() {
+                *pool = Some(WorkerPool::new());
+            }
+
+            if let Some(ref mut pool) = *pool {
+                pool.run(jobs.len(), &|index| unsafe { jobs[index].run() }, &mut |_| {});
+            }
+        });
+
+        unsafe {
+            mfb_update_prepared(handles.as_mut_ptr(), handles.len() as i32);
+        }
+
+        Ok(())
+    }
+
+    pub fn update_tile(&mut self, frame: *const u32, x: usize, y: usize, width: usize, height: usize) -> bool {
+        unsafe {
+            mfb_update_tile(self.window_handle, frame as *const c_uchar, 
+                            x as i32, y as i32, width as i32, height as i32) != 0
+        }
+    }
+
+    pub fn finish_tiles(&mut self) {
+        self.key_handler.update();
+
+        unsafe {
+            Self::set_shared_data(self);
+            mfb_finish_tiles(self.window_handle);
+            mfb_set_key_callback(self.window_handle,
+                                 mem::transmute(self),
+                                 key_callback,
+                                 char_callback);
+        }
+    }
+
+    pub fn update_mirrored_with_buffer(windows: &mut [&mut Window], buffer: &[u32]) -> Result<()> {
+        for window in windows.iter() {
+            let check_res = buffer_helper::check_buffer_size(window.shared_data.width as usize,
+                                                             window.shared_data.height as usize,
+                                                             window.shared_data.scale as usize,
+                                                             buffer);
+            if check_res.is_err() {
+                return check_res;
+            }
+        }
+
+        let mut handles = Vec::with_capacity(windows.len());
+
+        unsafe {
+            for window in windows.iter_mut() {
+                let window = &mut **window;
+                window.key_handler.update();
+                Self::set_shared_data(window);
+                mfb_set_key_callback(window.window_handle,
+                                     mem::transmute(&mut *window),
+                                     key_callback,
+                                     char_callback);
+                handles.push(window.window_handle);
+            }
+
+            mfb_update_mirrored(handles.as_mut_ptr(), handles.len() as i32, buffer.as_ptr() as *const c_uchar);
+        }
+
+        Ok(())
+    }
+
     pub fn update(&mut self) {
         self.key_handler.update();
 
@@ -269,6 +521,24 @@ impl Window {
         }
     }
 
+    pub fn dispatch_pending(&mut self) {
+        self.key_handler.update();
+
+        unsafe {
+            Self::set_shared_data(self);
+            mfb_dispatch_pending(self.window_handle);
+            mfb_set_key_callback(self.window_handle,
+            					 mem::transmute(self),
+            					 key_callback,
+            					 char_callback);
+        }
+    }
+
+    #[inline]
+    pub fn get_connection_fd(&self) -> i32 {
+        unsafe { mfb_get_connection_fd() }
+    }
+
     #[inline]
     pub fn get_window_handle(&self) -> *mut raw::c_void {
     	unsafe { mfb_get_window_handle(self.window_handle) as *mut raw::c_void }
@@ -316,6 +586,24 @@ impl Window {
         }
     }
 
+    pub fn set_precise_pointer(&mut self, enable: bool) -> bool {
+        unsafe { mfb_set_precise_pointer(self.window_handle, enable as i32) != 0 }
+    }
+
+    pub fn get_pointer_history(&self) -> &[PointerSample] {
+        let mut count = 0;
+
+        unsafe {
+            let samples = mfb_get_pointer_history(self.window_handle, &mut count);
+
+            if samples.is_null() {
+                &[]
+            } else {
+                slice::from_raw_parts(samples, count as usize)
+            }
+        }
+    }
+
     #[inline]
     pub fn set_cursor_style(&mut self, cursor: CursorStyle) {
         unsafe {
@@ -323,6 +611,92 @@ impl Window {
         }
     }
 
+    pub fn set_cursor_image(&mut self, image: &[u32], width: usize, height: usize,
+                            hot_x: usize, hot_y: usize) -> Result<()> {
+        let check_res = buffer_helper::check_cursor_image(width, height, hot_x, hot_y, image);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        unsafe {
+            if mfb_set_cursor_image(self.window_handle, image.as_ptr(), width as i32, height as i32,
+                                    hot_x as i32, hot_y as i32) == 0 {
+                return Err(Error::UpdateFailed("Unable to create cursor from image".to_owned()));
+            }
+        }
+
+        Ok(())
+    }
+
+    pub fn set_color_curves(&mut self, red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_color_curves(red, green, blue);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let mut curves = Vec::with_capacity(256 * 3);
+        curves.extend_from_slice(red);
+        curves.extend_from_slice(green);
+        curves.extend_from_slice(blue);
+
+        unsafe {
+            if mfb_set_color_curves(self.window_handle, curves.as_ptr()) == 0 {
+                return Err(Error::UpdateFailed("Unable to set color curves".to_owned()));
+            }
+        }
+
+        Ok(())
+    }
+
+    pub fn set_color_lut(&mut self, size: usize, lut: &[u32]) -> Result<()> {
+        let check_res = buffer_helper::check_color_lut(size, lut);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        unsafe {
+            if mfb_set_color_lut(self.window_handle, lut.as_ptr(), size as i32) == 0 {
+                return Err(Error::UpdateFailed("Unable to set color lut".to_owned()));
+            }
+        }
+
+        Ok(())
+    }
+
+    pub fn clear_color_transform(&mut self) {
+        unsafe {
+            mfb_set_color_curves(self.window_handle, ptr::null());
+            mfb_set_color_lut(self.window_handle, ptr::null(), 0);
+        }
+    }
+
+    pub fn set_post_effects(&mut self, effects: PostEffects) {
+        unsafe {
+            mfb_set_post_effects(self.window_handle, effects.scanlines as i32, effects.shadow_mask as i32,
+                                 effects.edge_blend as i32);
+        }
+    }
+
+    pub fn set_latency_tracking(&mut self, enable: bool) {
+        unsafe {
+            mfb_set_latency_tracking(self.window_handle, enable as i32);
+        }
+    }
+
+    pub fn latency_histogram(&self) -> Option<LatencyHistogram> {
+        let mut buckets = vec![0u32; LATENCY_BUCKETS];
+        let count = unsafe {
+            mfb_get_latency_histogram(self.window_handle, buckets.as_mut_ptr(), LATENCY_BUCKETS as i32)
+        };
+
+        if count == 0 {
+            return None;
+        }
+
+        buckets.truncate(count as usize);
+        Some(LatencyHistogram { buckets: buckets })
+    }
+
     #[inline]
     pub fn get_keys(&self) -> Option<Vec<Key>> {
         self.key_handler.get_keys()
@@ -374,6 +748,20 @@ impl Window {
         true
     }
 
+    // Largest integer scale where the (rotated) buffer fits the monitor the window opens on
+    unsafe fn get_fullscreen_scale(width: usize, height: usize, rotation: Rotation) -> i32 {
+        let wh: u32 = mfb_get_screen_size();
+        let screen_x = (wh >> 16) as usize;
+        let screen_y = (wh & 0xffff) as usize;
+
+        let (width, height) = match rotation {
+            Rotation::Rotate90 | Rotation::Rotate270 => (height, width),
+            _ => (width, height),
+        };
+
+        ((screen_x / width.max(1)).min(screen_y / height.max(1))).max(1) as i32
+    }
+
     unsafe fn get_scale_factor(width: usize, height: usize, scale: Scale) -> i32 {
         let factor: i32 = match scale {
             Scale::X1 => 1,
@@ -8,7 +8,7 @@ extern crate time;
 
 const INVALID_ACCEL: usize = 0xffffffff;
 
-use {Scale, Key, KeyRepeat, MouseButton, MouseMode, WindowOptions, InputCallback};
+use {Scale, Key, KeyRepeat, MouseButton, MouseMode, WindowOptions, InputCallback, PostEffects, LatencyHistogram, PointerSample, YuvFrame};
 use key_handler::KeyHandler;
 use error::Error;
 use Result;
@@ -343,6 +343,7 @@ pub struct Window {
     height: i32,
     menus: Vec<Menu>,
     key_handler: KeyHandler,
+    indexed: buffer_helper::IndexedFrame,
     accel_table: HACCEL,
     accel_key: usize,
     prev_cursor: CursorStyle,
@@ -463,6 +464,7 @@ impl Window {
                 window: Some(handle.unwrap()),
                 buffer: Vec::new(),
                 key_handler: KeyHandler::new(),
+                indexed: buffer_helper::IndexedFrame::new(),
                 is_open: true,
                 scale_factor: scale_factor,
                 width: width as i32,
@@ -547,6 +549,14 @@ impl Window {
         }
     }
 
+    pub fn set_precise_pointer(&mut self, _enable: bool) -> bool {
+        false
+    }
+
+    pub fn get_pointer_history(&self) -> &[PointerSample] {
+        &[]
+    }
+
     #[inline]
     pub fn set_cursor_style(&mut self, cursor: CursorStyle) {
         unsafe {
@@ -560,6 +570,47 @@ impl Window {
         }
     }
 
+    pub fn set_cursor_image(&mut self, image: &[u32], width: usize, height: usize,
+                            hot_x: usize, hot_y: usize) -> Result<()> {
+        let check_res = buffer_helper::check_cursor_image(width, height, hot_x, hot_y, image);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Cursor images are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_curves(&mut self, red: &[u8], green: &[u8], blue: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_color_curves(red, green, blue);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color curves are only supported on X11".to_owned()))
+    }
+
+    pub fn set_color_lut(&mut self, size: usize, lut: &[u32]) -> Result<()> {
+        let check_res = buffer_helper::check_color_lut(size, lut);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        Err(Error::NotSupported("Color luts are only supported on X11".to_owned()))
+    }
+
+    pub fn clear_color_transform(&mut self) {
+    }
+
+    pub fn set_post_effects(&mut self, _effects: PostEffects) {
+    }
+
+    pub fn set_latency_tracking(&mut self, _enable: bool) {
+    }
+
+    pub fn latency_histogram(&self) -> Option<LatencyHistogram> {
+        None
+    }
+
     #[inline]
     pub fn get_keys(&self) -> Option<Vec<Key>> {
         self.key_handler.get_keys()
@@ -663,6 +714,92 @@ impl Window {
         Ok(())
     }
 
+    pub fn update_with_buffer_stride(&mut self, buffer: &[u32], x: usize, y: usize, stride: usize) -> Result<()> {
+        let check_res = buffer_helper::check_buffer_stride(self.width as usize,
+                                                           self.height as usize,
+                                                           self.scale_factor as usize,
+                                                           x, y, stride, buffer);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_buffer_stride(self.width as usize,
+                                                       self.height as usize,
+                                                       self.scale_factor as usize,
+                                                       x, y, stride, buffer);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_yuv(&mut self, frame: &YuvFrame) -> Result<()> {
+        let check_res = buffer_helper::check_yuv_frame(self.width as usize,
+                                                       self.height as usize,
+                                                       self.scale_factor as usize,
+                                                       frame);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = buffer_helper::pack_yuv_frame(self.width as usize,
+                                                   self.height as usize,
+                                                   self.scale_factor as usize,
+                                                   frame);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn set_palette(&mut self, palette: &[u32]) -> Result<()> {
+        self.indexed.set_palette(palette)
+    }
+
+    pub fn update_with_indexed(&mut self, indices: &[u8]) -> Result<()> {
+        let check_res = buffer_helper::check_indexed_buffer(self.width as usize,
+                                                            self.height as usize,
+                                                            self.scale_factor as usize,
+                                                            indices);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        let packed = self.indexed.expand(self.width as usize,
+                                         self.height as usize,
+                                         self.scale_factor as usize,
+                                         indices);
+        self.update_with_buffer(&packed)
+    }
+
+    pub fn update_with_palette(&mut self, palette: &[u32]) -> Result<()> {
+        let check_res = self.indexed.set_palette(palette);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        match self.indexed.expand_cached() {
+            Some(packed) => self.update_with_buffer(&packed),
+            None => Err(buffer_helper::no_indexed_frame()),
+        }
+    }
+
+    pub fn scroll_region(&mut self, buffer: &[u32], _dx: isize, _dy: isize,
+                         x: usize, y: usize, width: usize, height: usize) -> Result<()> {
+        let check_res = buffer_helper::check_region(self.width as usize,
+                                                    self.height as usize,
+                                                    self.scale_factor as usize,
+                                                    x, y, width, height);
+        if check_res.is_err() {
+            return check_res;
+        }
+
+        // The buffer already holds the scrolled contents so a full update shows the same result
+        self.update_with_buffer(buffer)
+    }
+
+    pub fn update_tile(&mut self, _frame: *const u32, _x: usize, _y: usize, _width: usize, _height: usize) -> bool {
+        // The caller presents the finished frame as a whole
+        false
+    }
+
+    pub fn finish_tiles(&mut self) {
+    }
+
     pub fn update(&mut self) {
         let window = self.window.unwrap();
 
@@ -0,0 +1,199 @@
+//!
+//! Threads that run indexed tasks and stay alive between frames. Used to render the tiles of
+//! `Window::update_with_tiles` and by the X11 backend to scale the buffers of several windows in
+//! parallel.
+//!
+
+use std::panic::{self, AssertUnwindSafe};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, Sender};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::{self, JoinHandle};
+use std::fs::File;
+use std::io::Read;
+
+// Number of threads when the number of cores isn't known
+const DEFAULT_THREADS: usize = 4;
+
+// Number of cores, read from /proc/cpuinfo where it exists
+fn core_count() -> usize {
+    let mut text = String::new();
+
+    let res = match File::open("/proc/cpuinfo") {
+        Ok(mut file) => file.read_to_string(&mut text),
+        Err(e) => Err(e),
+    };
+
+    let count = match res {
+        Ok(_) => text.lines().filter(|line| line.starts_with("processor")).count(),
+        Err(_) => 0,
+    };
+
+    if count > 0 { count } else { DEFAULT_THREADS }
+}
+
+// The task only lives as long as the call to `WorkerPool::run` so its lifetime is erased while
+// it's shared with the workers. `run` doesn't return before every task is done which keeps it
+// from being used after that.
+struct Job {
+    task: *const (Fn(usize) + Sync),
+    count: usize,
+    next: AtomicUsize,
+    panicked: AtomicBool,
+    done: Mutex<Sender<usize>>,
+}
+
+unsafe impl Send for Job {}
+unsafe impl Sync for Job {}
+
+impl Job {
+    fn take(&self) -> Option<usize> {
+        let index = self.next.fetch_add(1, Ordering::Relaxed);
+
+        if index < self.count { Some(index) } else { None }
+    }
+
+    // Panics are caught so all tasks can be finished before the panic is passed on
+    fn run_task(&self, index: usize) {
+        let res = panic::catch_unwind(AssertUnwindSafe(|| unsafe { (*self.task)(index) }));
+
+        if res.is_err() {
+            self.panicked.store(true, Ordering::Relaxed);
+        }
+    }
+}
+
+struct State {
+    job: Option<Arc<Job>>,
+    generation: usize,
+    shutdown: bool,
+}
+
+struct Shared {
+    state: Mutex<State>,
+    wake: Condvar,
+}
+
+fn worker(shared: Arc<Shared>) {
+    let mut generation = 0;
+
+    loop {
+        let job = {
+            let mut state = shared.state.lock().unwrap();
+
+            while !state.shutdown && state.generation == generation {
+                state = shared.wake.wait(state).unwrap();
+            }
+
+            if state.shutdown {
+                return;
+            }
+
+            generation = state.generation;
+            state.job.clone()
+        };
+
+        if let Some(job) = job {
+            let done = job.done.lock().unwrap().clone();
+
+            while let Some(index) = job.take() {
+                job.run_task(index);
+                let _ = done.send(index);
+            }
+        }
+    }
+}
+
+///
+/// Threads that stay alive between frames. The tasks of a call to `run` are taken from a shared
+/// counter by the threads (and the calling thread) so threads that finish early keep taking
+/// tasks until all are done.
+///
+pub struct WorkerPool {
+    shared: Arc<Shared>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl WorkerPool {
+    pub fn new() -> WorkerPool {
+        let threads = core_count();
+        let shared = Arc::new(Shared {
+            state: Mutex::new(State { job: None, generation: 0, shutdown: false }),
+            wake: Condvar::new(),
+        });
+
+        // The calling thread runs tasks as well
+        let workers = (1..threads).map(|_| {
+            let shared = shared.clone();
+            thread::spawn(move || worker(shared))
+        }).collect();
+
+        WorkerPool {
+            shared: shared,
+            workers: workers,
+        }
+    }
+
+    ///
+    /// Runs `task` for each index in `0..count` and calls `finished` on the calling thread with
+    /// the index of each task as it's done. Returns when all tasks are done.
+    ///
+    pub fn run(&mut self, count: usize, task: &(Fn(usize) + Sync), finished: &mut FnMut(usize)) {
+        let (sender, receiver) = mpsc::channel();
+
+        let job = Arc::new(Job {
+            task: unsafe { ::std::mem::transmute(task) },
+            count: count,
+            next: AtomicUsize::new(0),
+            panicked: AtomicBool::new(false),
+            done: Mutex::new(sender),
+        });
+
+        {
+            let mut state = self.shared.state.lock().unwrap();
+            state.job = Some(job.clone());
+            state.generation = state.generation.wrapping_add(1);
+            self.shared.wake.notify_all();
+        }
+
+        // Report the tasks finished by the workers first, then help running them and only wait
+        // when all tasks have been taken
+        let mut done = 0;
+
+        while done < job.count {
+            let index = match receiver.try_recv() {
+                Ok(index) => index,
+                Err(_) => match job.take() {
+                    Some(index) => {
+                        job.run_task(index);
+                        index
+                    }
+                    None => receiver.recv().unwrap(),
+                },
+            };
+
+            finished(index);
+            done += 1;
+        }
+
+        self.shared.state.lock().unwrap().job = None;
+
+        if job.panicked.load(Ordering::Relaxed) {
+            panic!("Task of the worker pool panicked");
+        }
+    }
+}
+
+impl Drop for WorkerPool {
+    fn drop(&mut self) {
+        {
+            let mut state = self.shared.state.lock().unwrap();
+            state.shutdown = true;
+            self.shared.wake.notify_all();
+        }
+
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
@@ -0,0 +1,127 @@
+//!
+//! Renders a frame as tiles on a pool of threads so finished tiles can be scaled and presented
+//! while the rest of the frame is still being rendered, see `Window::update_with_tiles`.
+//!
+
+use std::marker::PhantomData;
+use std::fmt;
+use std::slice;
+use pool::WorkerPool;
+
+///
+/// A rectangle of the frame that is rendered by the callback given to
+/// `Window::update_with_tiles`. All tiles have the same size except at the right and bottom
+/// edges of the frame.
+///
+#[derive(Debug)]
+pub struct Tile<'a> {
+    /// Position of the tile in the frame
+    pub x: usize,
+    /// Position of the tile in the frame
+    pub y: usize,
+    /// Width of the tile in pixels
+    pub width: usize,
+    /// Height of the tile in pixels
+    pub height: usize,
+    stride: usize,
+    data: *mut u32,
+    _frame: PhantomData<&'a mut [u32]>,
+}
+
+impl<'a> Tile<'a> {
+    ///
+    /// Returns row `y` (relative to the top of the tile) of the tile. The contents are the
+    /// pixels from the previous frame so the whole tile should be drawn.
+    ///
+    pub fn row_mut(&mut self, y: usize) -> &mut [u32] {
+        assert!(y < self.height, "row {} is outside of the tile", y);
+
+        unsafe { slice::from_raw_parts_mut(self.data.offset((y * self.stride) as isize), self.width) }
+    }
+}
+
+///
+/// Frame and pool used by `Window::update_with_tiles`. Both are created the first time it's used.
+///
+pub struct Tiles {
+    width: usize,
+    height: usize,
+    frame: Vec<u32>,
+    pool: Option<WorkerPool>,
+}
+
+impl Tiles {
+    pub fn new(width: usize, height: usize) -> Tiles {
+        Tiles {
+            width: width,
+            height: height,
+            frame: Vec::new(),
+            pool: None,
+        }
+    }
+
+    ///
+    /// Renders all tiles of the frame and calls `present` with the frame and the rectangle of
+    /// each tile as it's finished (on the calling thread). Returns the finished frame.
+    ///
+    pub fn render<F>(&mut self, tile_size: usize, render: &F,
+                     present: &mut FnMut(*const u32, usize, usize, usize, usize)) -> &[u32]
+        where F: Fn(&mut Tile) + Sync
+    {
+        if self.pool.is_none() {
+            self.pool = Some(WorkerPool::new());
+            self.frame = vec![0; self.width * self.height];
+        }
+
+        let (width, height) = (self.width, self.height);
+        let tiles_x = (width + tile_size - 1) / tile_size;
+        let tiles_y = (height + tile_size - 1) / tile_size;
+        let frame = FramePtr(self.frame.as_mut_ptr());
+
+        let rect = |index: usize| {
+            let x = (index % tiles_x) * tile_size;
+            let y = (index / tiles_x) * tile_size;
+
+            (x, y, (width - x).min(tile_size), (height - y).min(tile_size))
+        };
+
+        // Each task writes only its own tile of the frame
+        let task = |index: usize| {
+            let (x, y, w, h) = rect(index);
+            let mut tile = Tile {
+                x: x,
+                y: y,
+                width: w,
+                height: h,
+                stride: width,
+                data: unsafe { frame.0.offset((y * width + x) as isize) },
+                _frame: PhantomData,
+            };
+
+            render(&mut tile);
+        };
+
+        if let Some(ref mut pool) = self.pool {
+            pool.run(tiles_x * tiles_y, &task, &mut |index| {
+                let (x, y, w, h) = rect(index);
+                present(frame.0, x, y, w, h);
+            });
+        }
+
+        &self.frame
+    }
+}
+
+// Frame shared by the tile tasks
+struct FramePtr(*mut u32);
+
+unsafe impl Sync for FramePtr {}
+
+impl fmt::Debug for Tiles {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        f.debug_struct("Tiles")
+            .field("width", &self.width)
+            .field("height", &self.height)
+            .finish()
+    }
+}
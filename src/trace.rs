@@ -0,0 +1,249 @@
+//!
+//! Records the time spent in minifb (updates, the phases of the native presentation, event
+//! dispatch and key callbacks) and writes it as a Chrome Trace Event file that can be opened in
+//! chrome://tracing or Perfetto, see `start_trace`.
+//!
+//! Timestamps are taken from the monotonic clock (`CLOCK_MONOTONIC` on Linux) so they can be
+//! lined up with traces of the application that use the same clock. While no trace is recorded
+//! each span costs a single atomic load.
+//!
+
+extern crate time;
+
+use error::Error;
+use Result;
+
+use std::fs::File;
+use std::io::{BufWriter, Write};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Mutex, Once, ONCE_INIT};
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+// The state is created on first use, Mutex::new can't be called in a static initializer on the
+// older compilers the crate supports
+#[allow(deprecated)]
+fn state() -> &'static Mutex<Option<State>> {
+    static INIT: Once = ONCE_INIT;
+    static mut STATE: *const Mutex<Option<State>> = 0 as *const Mutex<Option<State>>;
+
+    unsafe {
+        INIT.call_once(|| STATE = Box::into_raw(Box::new(Mutex::new(None))));
+        &*STATE
+    }
+}
+
+struct Event {
+    name: &'static str,
+    window: usize,
+    thread: usize,
+    begin: u64,
+    end: u64,
+}
+
+struct State {
+    file: File,
+    events: Vec<Event>,
+    // Each window is shown as a process with a track for each thread it's used from
+    windows: Vec<usize>,
+    threads: Vec<(usize, String)>,
+}
+
+fn escape(text: &str) -> String {
+    text.chars().flat_map(|c| match c {
+        '"' => vec!['\\', '"'],
+        '\\' => vec!['\\', '\\'],
+        c if (c as u32) < 0x20 => vec![' '],
+        c => vec![c],
+    }).collect()
+}
+
+///
+/// Starts recording a trace that is written to `path` by `stop_trace`. The file is created
+/// right away so a bad path is reported here. Events are kept in memory until the trace is
+/// stopped.
+///
+/// Currently only the X11 backend records spans.
+///
+/// # Examples
+///
+/// ```ignore
+/// minifb::start_trace("minifb.json").unwrap();
+/// // ... run the application
+/// minifb::stop_trace().unwrap();
+/// ```
+///
+pub fn start_trace(path: &str) -> Result<()> {
+    let mut state = state().lock().unwrap();
+
+    if state.is_some() {
+        return Err(Error::Trace("A trace is already being recorded".to_owned()));
+    }
+
+    let file = match File::create(path) {
+        Ok(file) => file,
+        Err(err) => return Err(Error::Trace(format!("Unable to create {}: {}", path, err))),
+    };
+
+    *state = Some(State {
+        file: file,
+        events: Vec::new(),
+        windows: Vec::new(),
+        threads: Vec::new(),
+    });
+
+    ENABLED.store(true, Ordering::Relaxed);
+
+    Ok(())
+}
+
+///
+/// Stops recording and writes the trace started with `start_trace`
+///
+pub fn stop_trace() -> Result<()> {
+    let state = state().lock().unwrap().take();
+
+    ENABLED.store(false, Ordering::Relaxed);
+
+    let mut state = match state {
+        Some(state) => state,
+        None => return Err(Error::Trace("No trace is being recorded".to_owned())),
+    };
+
+    let mut out = BufWriter::new(&state.file);
+    let mut lines = Vec::new();
+
+    for (index, _) in state.windows.iter().enumerate() {
+        lines.push(format!("{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"Window {}\"}}}}",
+                           index + 1, index + 1));
+
+        for &(thread, ref name) in state.threads.iter() {
+            lines.push(format!("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                               index + 1, thread, escape(name)));
+        }
+    }
+
+    for event in state.events.drain(..) {
+        lines.push(format!("{{\"name\":\"{}\",\"cat\":\"minifb\",\"ph\":\"X\",\"ts\":{:.3},\"dur\":{:.3},\"pid\":{},\"tid\":{}}}",
+                           escape(event.name), event.begin as f64 / 1000.0,
+                           event.end.saturating_sub(event.begin) as f64 / 1000.0, event.window + 1, event.thread));
+    }
+
+    let res = write!(out, "{{\"traceEvents\":[\n{}\n],\"displayTimeUnit\":\"ms\"}}\n", lines.join(",\n"))
+        .and_then(|_| out.flush());
+
+    match res {
+        Ok(_) => Ok(()),
+        Err(err) => Err(Error::Trace(format!("Unable to write trace: {}", err))),
+    }
+}
+
+// The recording side is only compiled for the X11 backend, the only one that records spans
+#[cfg(minifb_x11)]
+pub use self::recording::{enabled, record, span};
+
+#[cfg(minifb_x11)]
+mod recording {
+    use super::{ENABLED, Event, State, state};
+    use super::time;
+
+    use std::cell::Cell;
+    use std::sync::atomic::{AtomicUsize, Ordering};
+    use std::thread;
+
+    static NEXT_THREAD: AtomicUsize = AtomicUsize::new(1);
+
+    thread_local!(static THREAD_ID: Cell<usize> = Cell::new(0));
+
+    impl State {
+        fn window_index(&mut self, window: usize) -> usize {
+            match self.windows.iter().position(|w| *w == window) {
+                Some(index) => index,
+                None => {
+                    self.windows.push(window);
+                    self.windows.len() - 1
+                }
+            }
+        }
+    }
+
+    fn thread_id() -> usize {
+        THREAD_ID.with(|id| {
+            if id.get() == 0 {
+                id.set(NEXT_THREAD.fetch_add(1, Ordering::Relaxed));
+            }
+
+            id.get()
+        })
+    }
+
+    /// True while a trace is being recorded
+    #[inline]
+    pub fn enabled() -> bool {
+        ENABLED.load(Ordering::Relaxed)
+    }
+
+    /// Time in nanoseconds on the same clock as the native layer
+    #[inline]
+    pub fn now() -> u64 {
+        time::precise_time_ns()
+    }
+
+    ///
+    /// Adds a span of `window` on the track of the current thread. `window` is any value that
+    /// identifies the window (such as the native handle).
+    ///
+    pub fn record(window: usize, name: &'static str, begin: u64, end: u64) {
+        let thread = thread_id();
+        let mut guard = state().lock().unwrap();
+
+        if let Some(ref mut state) = *guard {
+            let window = state.window_index(window);
+
+            if !state.threads.iter().any(|t| t.0 == thread) {
+                let name = thread::current().name().map(|n| n.to_owned()).unwrap_or(format!("Thread {}", thread));
+                state.threads.push((thread, name));
+            }
+
+            state.events.push(Event {
+                name: name,
+                window: window,
+                thread: thread,
+                begin: begin,
+                end: end,
+            });
+        }
+    }
+
+    ///
+    /// Span that is recorded when it's dropped
+    ///
+    pub struct Span {
+        window: usize,
+        name: &'static str,
+        begin: u64,
+    }
+
+    impl Drop for Span {
+        fn drop(&mut self) {
+            record(self.window, self.name, self.begin, now());
+        }
+    }
+
+    ///
+    /// Starts a span that lasts until the returned value is dropped. Returns None (and does
+    /// nothing) while no trace is being recorded.
+    ///
+    #[inline]
+    pub fn span(window: usize, name: &'static str) -> Option<Span> {
+        if !enabled() {
+            return None;
+        }
+
+        Some(Span {
+            window: window,
+            name: name,
+            begin: now(),
+        })
+    }
+}
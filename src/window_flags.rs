@@ -4,8 +4,30 @@ const WINDOW_BORDERLESS: u32 = 1 << 1;
 const WINDOW_RESIZE: u32 = 1 << 2; 
 #[allow(dead_code)]
 const WINDOW_TITLE: u32 = 1 << 3; 
+#[allow(dead_code)]
+const WINDOW_RETAIN: u32 = 1 << 4;
+#[allow(dead_code)]
+const WINDOW_SERVER_SCALE: u32 = 1 << 5;
+#[allow(dead_code)]
+const WINDOW_SERVER_SCALE_BILINEAR: u32 = 1 << 6;
+#[allow(dead_code)]
+const WINDOW_BANDED: u32 = 1 << 7;
+#[allow(dead_code)]
+const WINDOW_ROTATE_90: u32 = 1 << 8;
+#[allow(dead_code)]
+const WINDOW_ROTATE_180: u32 = 2 << 8;
+#[allow(dead_code)]
+const WINDOW_ROTATE_270: u32 = 3 << 8;
+#[allow(dead_code)]
+const WINDOW_FLIP_X: u32 = 1 << 10;
+#[allow(dead_code)]
+const WINDOW_FLIP_Y: u32 = 1 << 11;
+#[allow(dead_code)]
+const WINDOW_FULLSCREEN: u32 = 1 << 12;
+#[allow(dead_code)]
+const WINDOW_EXCLUSIVE: u32 = 1 << 13;
 
-use WindowOptions;
+use {ScaleMode, Rotation, Fullscreen, WindowOptions};
 
 //
 // Construct a bitmask of flags (sent to backends) from WindowOpts
@@ -26,5 +48,40 @@ pub fn get_flags(opts: WindowOptions) -> u32 {
         flags |= WINDOW_RESIZE;
     }
 
+    if opts.retain {
+        flags |= WINDOW_RETAIN;
+    }
+
+    if opts.banded {
+        flags |= WINDOW_BANDED;
+    }
+
+    if opts.flip_x {
+        flags |= WINDOW_FLIP_X;
+    }
+
+    if opts.flip_y {
+        flags |= WINDOW_FLIP_Y;
+    }
+
+    match opts.rotation {
+        Rotation::None => (),
+        Rotation::Rotate90 => flags |= WINDOW_ROTATE_90,
+        Rotation::Rotate180 => flags |= WINDOW_ROTATE_180,
+        Rotation::Rotate270 => flags |= WINDOW_ROTATE_270,
+    }
+
+    match opts.fullscreen {
+        Fullscreen::None => (),
+        Fullscreen::Managed => flags |= WINDOW_FULLSCREEN,
+        Fullscreen::Exclusive => flags |= WINDOW_EXCLUSIVE,
+    }
+
+    match opts.scale_mode {
+        ScaleMode::Client => (),
+        ScaleMode::ServerNearest => flags |= WINDOW_SERVER_SCALE,
+        ScaleMode::ServerBilinear => flags |= WINDOW_SERVER_SCALE_BILINEAR,
+    }
+
     flags
 }